@@ -0,0 +1,220 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "analysis.h"
+#include "evaluate.h"
+#include "search.h"
+
+// Positions (or bytes of FEN text divided by this) per chunk taken by a thread
+const uint64_t analysis_chunk_size = 4096;
+const uint64_t fen_chunk_bytes = analysis_chunk_size * 64;
+
+// A chunk of the input: bytes [begin, end) holding positions starting at index
+struct AnalysisChunk {
+	uint64_t begin;
+	uint64_t end;
+	uint64_t index;
+};
+
+struct AnalysisState {
+	AnalysisSettings *settings;
+	const char *input;
+	bool packed;
+	AnalysisRecord *output;
+	std::vector<AnalysisChunk> chunks;
+	std::atomic<uint64_t> next_chunk;
+	std::atomic<uint64_t> nodes;
+	std::atomic<uint64_t> invalid;
+};
+
+// Map a whole file read-only, nullptr for an empty or missing file
+const char *map_input(std::string path, uint64_t &size) {
+	int file = open(path.c_str(), O_RDONLY);
+	if(file < 0) {
+		return nullptr;
+	}
+	struct stat status;
+	if(fstat(file, &status) < 0 || status.st_size == 0) {
+		close(file);
+		return nullptr;
+	}
+	void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(mapping == MAP_FAILED) {
+		return nullptr;
+	}
+	madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+	size = status.st_size;
+	return (const char *)mapping;
+}
+
+// Count the lines of each chunk in parallel (chunks end just after a newline), then turn the
+// counts into the index of each chunk's first position
+uint64_t index_fen_chunks(AnalysisState &state, uint64_t size, int threads) {
+	for(uint64_t begin = 0; begin < size;) {
+		uint64_t end = std::min(size, begin + fen_chunk_bytes);
+		const char *newline = end < size ? (const char *)memchr(state.input + end, '\n', size - end) : nullptr;
+		end = newline ? newline - state.input + 1 : size;
+		state.chunks.push_back({begin, end, 0});
+		begin = end;
+	}
+
+	std::vector<uint64_t> lines(state.chunks.size());
+	std::atomic<uint64_t> next(0);
+	auto count = [&]() {
+		for(uint64_t i = next++; i < state.chunks.size(); i = next++) {
+			const char *c = state.input + state.chunks[i].begin;
+			const char *end = state.input + state.chunks[i].end;
+			uint64_t found = 0;
+			while(c < end) {
+				const char *newline = (const char *)memchr(c, '\n', end - c);
+				found++;
+				c = newline ? newline + 1 : end;
+			}
+			lines[i] = found;
+		}
+	};
+	std::vector<std::thread> workers;
+	for(int i = 0; i < threads; i++) {
+		workers.emplace_back(count);
+	}
+	for(int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+
+	uint64_t total = 0;
+	for(uint64_t i = 0; i < state.chunks.size(); i++) {
+		state.chunks[i].index = total;
+		total += lines[i];
+	}
+	return total;
+}
+
+void analysis_worker(AnalysisState &state, Board &board) {
+	AnalysisSettings &settings = *state.settings;
+	TranspositionTable tt;
+	tt.resize(settings.hash);
+	std::unique_ptr<Search> search(new Search());
+	search->board = board;
+	search->tt = &tt;
+	search->quiet = true;
+	search->limits.depth = settings.depth;
+	Board &position = search->board;
+	std::vector<Move> move_list;
+	char fen [max_fen_length];
+	uint64_t nodes = 0;
+	uint64_t invalid = 0;
+
+	for(uint64_t i = state.next_chunk++; i < state.chunks.size(); i = state.next_chunk++) {
+		AnalysisChunk &chunk = state.chunks[i];
+		const char *c = state.input + chunk.begin;
+		const char *end = state.input + chunk.end;
+		for(uint64_t index = chunk.index; c < end; index++) {
+			AnalysisRecord &record = state.output[index];
+			record = AnalysisRecord();
+
+			bool valid;
+			if(state.packed) {
+				valid = position.unpack(*(const PackedPosition *)c);
+				c += sizeof(PackedPosition);
+			} else {
+				const char *newline = (const char *)memchr(c, '\n', end - c);
+				uint64_t length = (newline ? newline : end) - c;
+				valid = length < max_fen_length;
+				if(valid) {
+					memcpy(fen, c, length);
+					fen[length] = 0;
+					valid = position.initialize_fen(fen);
+				}
+				c = newline ? newline + 1 : end;
+			}
+			if(!valid) {
+				invalid++;
+				continue;
+			}
+
+			position.legal_moves(move_list);
+			record.legal_moves = move_list.size();
+			record.eval = evaluate(position, search->material_table);
+			record.status = ANALYSIS_VALID | (position.in_check() ? ANALYSIS_IN_CHECK : 0);
+			if(settings.depth > 0 && !move_list.empty()) {
+				tt.clear();
+				search->clear();
+				search->stop = false;
+				record.best_move = PackedMove(search->start()).move;
+				record.score = search->best_score;
+				nodes += search->nodes;
+			}
+		}
+	}
+	state.nodes += nodes;
+	state.invalid += invalid;
+}
+
+bool analyse_positions(Board &board, AnalysisSettings &settings) {
+	auto start = std::chrono::steady_clock::now();
+	AnalysisState state;
+	state.settings = &settings;
+	state.next_chunk = 0;
+	state.nodes = 0;
+	state.invalid = 0;
+	int threads = std::max(1, settings.threads);
+
+	uint64_t size = 0;
+	state.input = map_input(settings.input, size);
+	if(!state.input) {
+		std::cout << "could not open " << settings.input << "\n";
+		return false;
+	}
+	state.packed = settings.input.size() >= 4 && settings.input.compare(settings.input.size() - 4, 4, ".bin") == 0;
+	uint64_t positions;
+	if(state.packed) {
+		positions = size / sizeof(PackedPosition);
+		for(uint64_t index = 0; index < positions; index += analysis_chunk_size) {
+			uint64_t last = std::min(positions, index + analysis_chunk_size);
+			state.chunks.push_back({index * sizeof(PackedPosition), last * sizeof(PackedPosition), index});
+		}
+	} else {
+		positions = index_fen_chunks(state, size, threads);
+	}
+
+	// Preallocate the output so every thread writes its own records in place
+	uint64_t output_size = positions * sizeof(AnalysisRecord);
+	int file = open(settings.output.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	void *mapping = MAP_FAILED;
+	if(file >= 0 && ftruncate(file, output_size) == 0 && output_size > 0) {
+		mapping = mmap(nullptr, output_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	}
+	if(file >= 0) {
+		close(file);
+	}
+	if(mapping == MAP_FAILED) {
+		std::cout << "could not create " << settings.output << "\n";
+		munmap((void *)state.input, size);
+		return false;
+	}
+	state.output = (AnalysisRecord *)mapping;
+
+	std::vector<std::thread> workers;
+	for(int i = 0; i < threads; i++) {
+		workers.emplace_back(analysis_worker, std::ref(state), std::ref(board));
+	}
+	for(int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+	munmap(mapping, output_size);
+	munmap((void *)state.input, size);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "positions " << positions << " invalid " << state.invalid << " nodes " << state.nodes << " threads " << threads;
+	std::cout << " time " << seconds << "s positions/s " << (uint64_t)(positions / std::max(seconds, 1e-9)) << std::endl;
+	return true;
+}
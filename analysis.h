@@ -0,0 +1,35 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <string>
+#include "board.h"
+
+// Result for one input position, written at the position's index in the output file
+struct AnalysisRecord {
+    int16_t eval;       // Static evaluation from the side to move's point of view
+    int16_t score;      // Search score (0 without a search)
+    uint16_t best_move; // PackedMove of the search (0 without a search)
+    uint8_t legal_moves;
+    uint8_t status;     // analysis_status bits
+};
+static_assert(sizeof(AnalysisRecord) == 8, "AnalysisRecord must stay 8 bytes");
+
+enum analysis_status {ANALYSIS_VALID = 1, ANALYSIS_IN_CHECK = 2};
+
+struct AnalysisSettings {
+    std::string input;  // FEN lines, or packed positions when the name ends in .bin
+    std::string output;
+    int depth = 0;      // Search depth, 0 for legal moves and static evaluation only
+    int threads = 1;
+    int hash = 1;       // Transposition table megabytes per thread
+};
+
+// Analyse every position of a memory-mapped input file. The input is cut into chunks that the threads
+// take from a shared counter, each thread reusing one board and search, and results go straight into
+// a memory-mapped output file preallocated to one record per position.
+// The transposition table and move ordering are cleared for every position, so results do not depend
+// on the number of threads or the order in which chunks are taken.
+bool analyse_positions(Board &board, AnalysisSettings &settings);
+
+#endif
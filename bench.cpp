@@ -0,0 +1,133 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include "bench.h"
+#include "huge_pages.h"
+#include "search.h"
+#include "stats.h"
+#include "uci.h"
+
+// Openings, middlegames with both kings castled or exposed, and endgames from pawn races to mates
+const char *bench_positions [] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+	"4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+	"rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+	"r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+	"r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+	"r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+	"r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+	"4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+	"2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+	"r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+	"3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+	"r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+	"4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+	"3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+	"6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+	"3r4/5pk1/5Npp/p2p4/P1pPr3/6P1/1P1R1P1P/4R1K1 w - - 0 40",
+	"2r5/8/1b1k4/1p1p4/pP1P1Rp1/P1P2p2/5P2/4R1K1 b - - 0 44",
+	"r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+	"rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+	"rnbqk2r/ppp1ppbp/3p1np1/8/2PPP3/2N5/PP3PPP/R1BQKBNR w KQkq - 1 5",
+	"r1bqk2r/2ppbppp/p1n2n2/1p2p3/4P3/1B3N2/PPPP1PPP/RNBQR1K1 b kq - 1 7",
+	"rnbq1rk1/pp2ppbp/3p1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R b KQ - 2 8",
+	"r2qkb1r/pp1n1ppp/2p1pn2/3p1b2/2PP4/1QN1PN2/PP3PPP/R1B1KB1R w KQkq - 2 7",
+	"r1b2rk1/2q1bppp/p2ppn2/1p6/3BPP2/2N2B2/PPP3PP/R2Q1R1K w - - 4 14",
+	"2kr3r/ppp2ppp/2n5/2b1q3/4P1b1/2NB1N2/PPP2PPP/R2Q1RK1 w - - 0 11",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"2r2rk1/1bqnbppp/p2ppn2/1p6/3NPP2/P1N1B1P1/1PP3BP/R2Q1RK1 w - - 3 15",
+	"r2q1rk1/1b2bppp/p2p1n2/1pn1p3/4P3/1BN1BN2/PPP1QPPP/R4RK1 w - - 4 12",
+	"1r2r1k1/pp3ppp/2p5/3n4/3P1B2/2P3P1/P4PKP/R3R3 b - - 2 22",
+	"2r3k1/pp3ppp/4p3/3p4/3P1n2/2P1RN2/PP3PPP/6K1 w - - 0 25",
+	"8/pp2r1k1/2p1p3/3pP2p/3P1Pp1/1P2K1P1/P1R5/8 w - - 4 37",
+	"r5k1/5ppp/1p6/p1pB4/P1P5/1P3P2/6PP/3R2K1 b - - 0 30",
+	"6k1/5p2/6p1/8/7p/8/6PP/6K1 b - - 0 1",
+	"8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+	"8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+	"8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+	"8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+	"8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+	"8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+	"6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+	"r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+	"8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+	"8/8/8/8/1k6/8/8/1KQ5 w - - 0 1",
+	"8/8/4k3/8/8/8/2R5/4K3 w - - 0 1",
+	"8/5k2/8/5P2/5K2/8/8/8 w - - 0 1",
+	"8/8/8/3k4/8/8/3PK3/8 w - - 0 1",
+	"4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1",
+	"1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1"
+};
+
+void bench(Board &board, int depth, int threads, int hash, int multi_pv, std::string generation) {
+	TranspositionTable tt;
+	tt.resize(hash);
+	std::unique_ptr<Search> search(new Search());
+	search->tt = &tt;
+	search->quiet = true;
+	search->set_threads(threads);
+	search->options.pseudo_legal = generation == "pseudo";
+
+	// Total nodes and milliseconds of a run over every position
+	int count = sizeof(bench_positions) / sizeof(bench_positions[0]);
+	auto run = [&](int lines, uint64_t &nodes, int64_t &time) {
+		search->multi_pv = lines;
+		nodes = 0;
+		auto start = std::chrono::steady_clock::now();
+		for(int i = 0; i < count; i++) {
+			if(!board.initialize_fen(bench_positions[i])) {
+				std::cout << "invalid bench position " << bench_positions[i] << "\n";
+				continue;
+			}
+			tt.clear();
+			search->clear();
+			search->board = board;
+			search->limits = SearchLimits();
+			search->limits.depth = depth;
+			search->stop = false;
+			Move best_move = search->start();
+			nodes += search->total_nodes();
+			std::cout << "position " << i + 1 << "/" << count << " bestmove " << board.move_to_uci(best_move) << " nodes " << search->total_nodes() << "\n";
+		}
+		time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	// With several lines the single line run comes first, as the baseline for the overhead
+	uint64_t single_nodes = 0;
+	int64_t single_time = 0;
+	if(multi_pv > 1) {
+		run(1, single_nodes, single_time);
+	}
+	reset_statistics();
+	search->reset_tree_statistics();
+	uint64_t nodes;
+	int64_t time;
+	run(multi_pv, nodes, time);
+
+	// The same run again with the other generator, for its speed
+	uint64_t pseudo_nodes = 0;
+	int64_t pseudo_time = 0;
+	if(generation == "both") {
+		search->options.pseudo_legal = true;
+		run(multi_pv, pseudo_nodes, pseudo_time);
+	}
+
+	std::cout << "\n===========================\n";
+	std::cout << "Total time (ms) : " << time << "\n";
+	std::cout << "Nodes searched  : " << nodes << "\n";
+	std::cout << "Nodes/second    : " << nodes * 1000 / (time ? time : 1) << std::endl;
+	if(generation == "both") {
+		std::cout << "Pseudo-legal    : " << pseudo_nodes << " nodes, " << pseudo_nodes * 1000 / (pseudo_time ? pseudo_time : 1) << " nodes/second" << std::endl;
+	}
+	if(multi_pv > 1) {
+		std::cout << "MultiPV " << multi_pv << " cost : " << (double)nodes / (single_nodes ? single_nodes : 1) << " x nodes, " << (double)time / (single_time ? single_time : 1) << " x time of one line" << std::endl;
+	}
+	print_large_pages("");
+	if(statistics_enabled) {
+		print_statistics(false);
+		search->print_tree_statistics("");
+	}
+	board.initialize_fen(start_position);
+}
@@ -0,0 +1,16 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+#include "board.h"
+
+// Fixed-depth searches over a built-in set of positions, each from a cleared transposition table.
+// The total node count is a signature of the search (on one thread it only changes with functional
+// changes) and nodes per second measures speed. It is also the training run for profile-guided
+// builds: build with -fprofile-generate, run "bench", then rebuild with -fprofile-use.
+// With multi_pv above one it also runs single line searches first and reports what the extra
+// lines cost relative to them. Moves are generated legally, pseudo-legally ("pseudo") or both ways
+// in turn ("both"), which reports the speed of each.
+void bench(Board &board, int depth, int threads, int hash, int multi_pv, std::string generation);
+
+#endif
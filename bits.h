@@ -1,3 +1,6 @@
+#ifndef BITS_H
+#define BITS_H
+
 #include <iostream>
 #include <bitset>
 #include <cstdint>
@@ -53,3 +56,5 @@ inline void set_bit(uint64_t &bitboard, int square) {
 inline uint64_t get_bit(uint64_t bitboard, int square) {
     return bitboard & (1ULL << square);
 }
+
+#endif
@@ -1,9 +1,13 @@
 #include <iostream>
 #include <string>
+#include <cstdio>
+#include <algorithm>
 #include "board.h"
 #include "arrays.h"
 #include "magic.h"
 #include "bits.h"
+#include "stats.h"
+#include "huge_pages.h"
 
 // Some pseudocode taken and rewritten from the resource https://www.chessprogramming.org/Main_Page
 
@@ -81,6 +85,11 @@ uint64_t Board::x_ray_bishop_attacks(int square, uint64_t occupancy, uint64_t bl
 
 // Find pieces that attack a specific square
 uint64_t Board::attacks_to_square(int square) {
+	return attacks_to_square(square, occupancies[BOTH]);
+}
+
+// The same with other squares occupied, for pieces seen through a moving piece
+uint64_t Board::attacks_to_square(int square, uint64_t occupancy) {
 	uint64_t attackers = 0ULL;
 	bool opp_side = !side;
 	// Pawns
@@ -93,10 +102,10 @@ uint64_t Board::attacks_to_square(int square) {
 
 	// Bishops and Queens
 	board = bitboards[WB + opp_side] | bitboards[WQ + opp_side];
-	attackers |= bishop_attacks(square, occupancies[BOTH]) & board;
+	attackers |= bishop_attacks(square, occupancy) & board;
 	// Rooks and Queens
 	board = bitboards[WR + opp_side] | bitboards[WQ + opp_side];
-	attackers |= rook_attacks(square, occupancies[BOTH]) & board;
+	attackers |= rook_attacks(square, occupancy) & board;
 	// Kings
 	board = bitboards[WK + opp_side];
 	attackers |= king_mask[square] & board;
@@ -153,6 +162,102 @@ uint64_t Board::absolute_pins(int square) {
 	return pinned;
 }
 
+// Squares attacked by a piece standing on square
+uint64_t Board::piece_attacks(int piece, int square, uint64_t occupancy) {
+	switch(piece >> 1) {
+		case 0:
+			return pawn_attacks[piece & 1][square];
+		case 1:
+			return knight_mask[square];
+		case 2:
+			return bishop_attacks(square, occupancy);
+		case 3:
+			return rook_attacks(square, occupancy);
+		case 4:
+			return queen_attacks(square, occupancy);
+		default:
+			return king_mask[square];
+	}
+}
+
+// Whether the side to move is in check
+bool Board::in_check() {
+	int king_square = lsb(bitboards[WK + side]);
+	if(incremental_attacks) {
+		return (square_attackers[king_square] & occupancies[!side]) != 0;
+	}
+	return attacks_to_square(king_square) != 0;
+}
+
+void Board::set_incremental_attacks(bool enabled) {
+	incremental_attacks = enabled;
+	if(enabled) {
+		generate_attacks();
+	}
+}
+
+// Rebuild the attack tables from scratch
+void Board::generate_attacks() {
+	for(int square = 0; square < 64; square++) {
+		piece_attack_sets[square] = 0ULL;
+		square_attackers[square] = 0ULL;
+	}
+	uint64_t board = occupancies[BOTH];
+	for(; board; board &= board - 1) {
+		int square = lsb(board);
+		uint64_t attacks = piece_attacks(piece_list[square], square, occupancies[BOTH]);
+		piece_attack_sets[square] = attacks;
+		for(; attacks; attacks &= attacks - 1) {
+			square_attackers[lsb(attacks)] |= 1ULL << square;
+		}
+	}
+}
+
+// Account for a piece placed on or removed from square, after the occupancies have changed
+void Board::update_attacks(int square, int piece, bool placed) {
+	// The piece's own attacks
+	uint64_t attacks = placed ? piece_attacks(piece, square, occupancies[BOTH]) : piece_attack_sets[square];
+	piece_attack_sets[square] = placed ? attacks : 0ULL;
+	for(; attacks; attacks &= attacks - 1) {
+		square_attackers[lsb(attacks)] ^= 1ULL << square;
+	}
+
+	// Sliders seeing the square are now blocked there or see through it
+	uint64_t sliders = square_attackers[square] & (bitboards[WB] | bitboards[BB] | bitboards[WR] | bitboards[BR] | bitboards[WQ] | bitboards[BQ]);
+	for(; sliders; sliders &= sliders - 1) {
+		int slider = lsb(sliders);
+		uint64_t updated = piece_attacks(piece_list[slider], slider, occupancies[BOTH]);
+		uint64_t changed = updated ^ piece_attack_sets[slider];
+		piece_attack_sets[slider] = updated;
+		for(; changed; changed &= changed - 1) {
+			square_attackers[lsb(changed)] ^= 1ULL << slider;
+		}
+	}
+}
+
+// The part of attack_map that move generation looks at (the squares around the king and those
+// castling passes), read from the attack tables
+uint64_t Board::king_attack_map(int king_square, uint64_t checkers) {
+	uint64_t mapped_attacks = 0ULL;
+	uint64_t squares = king_mask[king_square];
+	if(castling_rights.back() & (5 << side)) {
+		squares |= castling_check_mask[side][0] | castling_check_mask[side][1];
+	}
+	for(; squares; squares &= squares - 1) {
+		int square = lsb(squares);
+		if(square_attackers[square] & occupancies[!side]) {
+			mapped_attacks |= 1ULL << square;
+		}
+	}
+	// Sliders giving check also attack the squares behind the king
+	uint64_t sliders = checkers & ~(bitboards[WP + !side] | bitboards[WN + !side]);
+	for(; sliders; sliders &= sliders - 1) {
+		int slider = lsb(sliders);
+		mapped_attacks |= piece_attacks(piece_list[slider], slider, occupancies[BOTH] ^ bitboards[WK + side]);
+	}
+	return mapped_attacks;
+}
+
 // Populate a vector with legal moves
 void Board::legal_moves(std::vector<Move> &move_list) {
 	// Initialize some variables
@@ -161,13 +266,14 @@ void Board::legal_moves(std::vector<Move> &move_list) {
 	int king_square = lsb(bitboards[WK + side]);
 	uint64_t board = 0ULL;
 	uint64_t targets = 0ULL;
-	uint64_t checkers = attacks_to_square(king_square);
+	uint64_t checkers = incremental_attacks ? square_attackers[king_square] & occupancies[!side] : attacks_to_square(king_square);
 	uint64_t check_mask;
 	uint64_t pin_mask;
 
 	// Generate pin masks
 	uint64_t hv_pinmask = x_ray_rook_attacks(king_square, occupancies[BOTH], occupancies[side]) & (bitboards[WR + !side] | bitboards[WQ + !side]);
 	uint64_t da_pinmask = x_ray_bishop_attacks(king_square, occupancies[BOTH], occupancies[side]) & (bitboards[WB + !side] | bitboards[WQ + !side]);
+	uint64_t pinners = hv_pinmask | da_pinmask;
 	board = hv_pinmask;
 	for(; board; board &= board - 1) {
 		hv_pinmask |= in_between[lsb(board)] [king_square];
@@ -177,15 +283,29 @@ void Board::legal_moves(std::vector<Move> &move_list) {
 		da_pinmask |= in_between[lsb(board)] [king_square];
 	}
 
+	// The ray of the pin holding square, pinner included. Pawns need it: unlike sliders they can
+	// step off their own ray onto another pin ray.
+	auto pin_line = [&](int square) -> uint64_t {
+		for(uint64_t pinner = pinners; pinner; pinner &= pinner - 1) {
+			uint64_t line = in_between[lsb(pinner)] [king_square] | (pinner & -pinner);
+			if(line & 1ULL << square) {
+				return line;
+			}
+		}
+		return 0ULL;
+	};
+
 	// Get king moves
 	board = bitboards[WK + side];
-	uint64_t king_attack_map = attack_map(occupancies[BOTH] ^ board);
-	targets = king_mask[king_square] & ~occupancies[side] & ~king_attack_map;
+	uint64_t king_attacks = incremental_attacks ? king_attack_map(king_square, checkers) : attack_map(occupancies[BOTH] ^ board);
+	targets = king_mask[king_square] & ~occupancies[side] & ~king_attacks;
 	for(; targets; targets &= targets - 1) {
 		target_square = lsb(targets);
 		move_list.push_back(Move(king_square, target_square, WK + side, piece_list[target_square], 0, none));
 	}
 
+	count(STAT_GENERATIONS);
+	count(STAT_NO_CHECK + pop_count(checkers));
 	switch(pop_count(checkers)) {
 		case 2: // No other piece moves possible
 			break;
@@ -330,11 +450,11 @@ void Board::legal_moves(std::vector<Move> &move_list) {
 				}
 			}
 
-			// Pawns (pinned and not promoting)
+			// Pawns (pinned and not promoting), which stay on their own pin line
 			board = bitboards[WP + side] & ~promotion_ranks[side] & (hv_pinmask | da_pinmask);
 			for(; board; board &= board - 1) {
 				source_square = lsb(board);
-				targets = (pawn_attacks[side][source_square] & occupancies[!side] & da_pinmask) | (pawn_pushes[side][source_square] & file_attacks(source_square, occupancies[BOTH]) & ~occupancies[BOTH] & hv_pinmask);
+				targets = ((pawn_attacks[side][source_square] & occupancies[!side]) | (pawn_pushes[side][source_square] & file_attacks(source_square, occupancies[BOTH]) & ~occupancies[BOTH])) & pin_line(source_square);
 				for(; targets; targets &= targets - 1) {
 					target_square = lsb(targets);
 					move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], 0, ((1ULL << source_square & rank_2_7[side]) && (1ULL << target_square & rank_4_5[side])) << 2));
@@ -363,7 +483,7 @@ void Board::legal_moves(std::vector<Move> &move_list) {
 				//get source square
 				source_square = lsb(board);
 				//get targets for attacks
-				targets = (pawn_attacks[side][source_square] & occupancies[!side] & da_pinmask) | (pawn_pushes[side][source_square] & ~occupancies[BOTH] & hv_pinmask);
+				targets = ((pawn_attacks[side][source_square] & occupancies[!side]) | (pawn_pushes[side][source_square] & ~occupancies[BOTH])) & pin_line(source_square);
 				for(; targets; targets &= targets - 1) {
 					target_square = lsb(targets);
 					move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], WN, none));
@@ -387,17 +507,239 @@ void Board::legal_moves(std::vector<Move> &move_list) {
 			// Castling
 			int castle = castling_rights.back();
 			// Handle king-side castling
-			if((castle & (1 << side)) && !(castling_occupancy_mask[side][0] & occupancies[BOTH]) && !(castling_check_mask[side][0] & king_attack_map)) {
+			if((castle & (1 << side)) && !(castling_occupancy_mask[side][0] & occupancies[BOTH]) && !(castling_check_mask[side][0] & king_attacks)) {
 				move_list.push_back(Move(castling_locations[side][0], castling_locations[side][3], WK + side, E, 0, k_castling));
 			}
 
 			// Handle queen-side castling
-			if((castle & (4 << side)) && !(castling_occupancy_mask[side][1] & occupancies[BOTH]) && !(castling_check_mask[side][1] & king_attack_map)) {
+			if((castle & (4 << side)) && !(castling_occupancy_mask[side][1] & occupancies[BOTH]) && !(castling_check_mask[side][1] & king_attacks)) {
 				move_list.push_back(Move(castling_locations[side][0], castling_locations[side][4], WK + side, E, 0, q_castling));
 			}
 
 			break;
 	}
+	count(STAT_MOVES_GENERATED, move_list.size());
+}
+
+// Populate a vector with legal captures and promotions (for quiescence search)
+void Board::legal_captures(std::vector<Move> &move_list) {
+	legal_moves(move_list);
+	int captures = 0;
+	for(int i = 0; i < move_list.size(); i++) {
+		if(move_list[i].capture() != E || move_list[i].promote()) {
+			move_list[captures++] = move_list[i];
+		}
+	}
+	move_list.resize(captures);
+}
+
+// Populate a vector with pseudo-legal moves: every move of the pieces, ignoring pins and checks, and
+// castling through empty squares. Each move is checked with is_legal once it is tried.
+void Board::pseudo_legal_moves(std::vector<Move> &move_list) {
+	move_list.clear();
+	int target_square, source_square;
+	uint64_t board, targets;
+
+	// Horizontal sliders
+	board = bitboards[WQ + side] | bitboards[WR + side];
+	for(; board; board &= board - 1) {
+		source_square = lsb(board);
+		targets = rook_attacks(source_square, occupancies[BOTH]) & ~occupancies[side];
+		for(; targets; targets &= targets - 1) {
+			target_square = lsb(targets);
+			move_list.push_back(Move(source_square, target_square, piece_list[source_square], piece_list[target_square], 0, none));
+		}
+	}
+
+	// Diagonal sliders
+	board = bitboards[WQ + side] | bitboards[WB + side];
+	for(; board; board &= board - 1) {
+		source_square = lsb(board);
+		targets = bishop_attacks(source_square, occupancies[BOTH]) & ~occupancies[side];
+		for(; targets; targets &= targets - 1) {
+			target_square = lsb(targets);
+			move_list.push_back(Move(source_square, target_square, piece_list[source_square], piece_list[target_square], 0, none));
+		}
+	}
+
+	// Knights
+	board = bitboards[WN + side];
+	for(; board; board &= board - 1) {
+		source_square = lsb(board);
+		targets = knight_mask[source_square] & ~occupancies[side];
+		for(; targets; targets &= targets - 1) {
+			target_square = lsb(targets);
+			move_list.push_back(Move(source_square, target_square, WN + side, piece_list[target_square], 0, none));
+		}
+	}
+
+	// King
+	source_square = lsb(bitboards[WK + side]);
+	targets = king_mask[source_square] & ~occupancies[side];
+	for(; targets; targets &= targets - 1) {
+		target_square = lsb(targets);
+		move_list.push_back(Move(source_square, target_square, WK + side, piece_list[target_square], 0, none));
+	}
+
+	// Pawns (not promoting)
+	board = bitboards[WP + side] & ~promotion_ranks[side];
+	for(; board; board &= board - 1) {
+		source_square = lsb(board);
+		targets = (pawn_attacks[side][source_square] & occupancies[!side]) | (pawn_pushes[side][source_square] & file_attacks(source_square, occupancies[BOTH]) & ~occupancies[BOTH]);
+		for(; targets; targets &= targets - 1) {
+			target_square = lsb(targets);
+			move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], 0, ((1ULL << source_square & rank_2_7[side]) && (1ULL << target_square & rank_4_5[side])) << 2));
+		}
+	}
+
+	// Pawns (promoting)
+	board = bitboards[WP + side] & promotion_ranks[side];
+	for(; board; board &= board - 1) {
+		source_square = lsb(board);
+		targets = (pawn_attacks[side][source_square] & occupancies[!side]) | (pawn_pushes[side][source_square] & ~occupancies[BOTH]);
+		for(; targets; targets &= targets - 1) {
+			target_square = lsb(targets);
+			move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], WN, none));
+			move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], WB, none));
+			move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], WR, none));
+			move_list.push_back(Move(source_square, target_square, WP + side, piece_list[target_square], WQ, none));
+		}
+	}
+
+	// En passant
+	board = pawn_attacks[!side] [en_passant_square.back()] & bitboards[WP + side];
+	for(; board; board &= board - 1) {
+		move_list.push_back(Move(lsb(board), en_passant_square.back(), WP + side, WP + !side, 0, en_passant));
+	}
+
+	// Castling (the squares the king crosses are looked at by is_legal)
+	int castle = castling_rights.back();
+	if((castle & (1 << side)) && !(castling_occupancy_mask[side][0] & occupancies[BOTH])) {
+		move_list.push_back(Move(castling_locations[side][0], castling_locations[side][3], WK + side, E, 0, k_castling));
+	}
+	if((castle & (4 << side)) && !(castling_occupancy_mask[side][1] & occupancies[BOTH])) {
+		move_list.push_back(Move(castling_locations[side][0], castling_locations[side][4], WK + side, E, 0, q_castling));
+	}
+	count(STAT_PSEUDO_GENERATIONS);
+	count(STAT_PSEUDO_MOVES_GENERATED, move_list.size());
+}
+
+// Pseudo-legal captures and promotions (for quiescence search)
+void Board::pseudo_legal_captures(std::vector<Move> &move_list) {
+	pseudo_legal_moves(move_list);
+	int captures = 0;
+	for(int i = 0; i < move_list.size(); i++) {
+		if(move_list[i].capture() != E || move_list[i].promote()) {
+			move_list[captures++] = move_list[i];
+		}
+	}
+	move_list.resize(captures);
+}
+
+// Whether a pseudo-legal move leaves the king out of check. The king's own moves look at the target
+// square (and the squares castling crosses); other moves look for attackers of the king with the
+// source square emptied and the target square filled, ignoring a piece captured on the target.
+bool Board::is_legal(Move move) {
+	count(STAT_LEGALITY_CHECKS);
+	int source_square = move.source();
+	int target_square = move.target();
+	int king_square = lsb(bitboards[WK + side]);
+	uint64_t target = 1ULL << target_square;
+	switch(move.flag()) {
+		case k_castling:
+		case q_castling: {
+			if(attacks_to_square(king_square)) {
+				return false;
+			}
+			uint64_t squares = castling_check_mask[side][move.flag() == q_castling];
+			for(; squares; squares &= squares - 1) {
+				if(attacks_to_square(lsb(squares))) {
+					return false;
+				}
+			}
+			return true;
+		}
+		case en_passant: {
+			// The captured pawn leaves its square too
+			uint64_t captured = pawn_pushes[!side][target_square];
+			uint64_t occupancy = (occupancies[BOTH] ^ (1ULL << source_square) ^ captured) | target;
+			return !(attacks_to_square(king_square, occupancy) & ~captured);
+		}
+		default:
+			if(move.piece() == WK + side) {
+				return !attacks_to_square(target_square, occupancies[BOTH] ^ (1ULL << source_square));
+			}
+			return !(attacks_to_square(king_square, (occupancies[BOTH] ^ (1ULL << source_square)) | target) & ~target);
+	}
+}
+
+// Find the move of a piece (given by its white code) to a target square for notation input, using the
+// attack tables instead of generating every legal move. from_file and from_rank are -1 when not given.
+// Returns an empty move unless exactly one piece can legally make the move.
+Move Board::resolve_move(int piece, int target_square, int from_file, int from_rank, int promote) {
+	piece += side;
+	uint64_t pieces = bitboards[piece];
+	uint64_t candidates = 0ULL;
+	int flag = none;
+	switch(piece >> 1) {
+		case 0: // Pawns capture from another file and push onto an empty square
+			if(from_file >= 0 && from_file != (target_square & 7)) {
+				candidates = pawn_attacks[!side][target_square] & pieces;
+				if(target_square == en_passant_square.back()) {
+					flag = en_passant;
+				} else if(piece_list[target_square] == E) {
+					candidates = 0ULL;
+				}
+			} else if(piece_list[target_square] == E) {
+				int behind = side ? target_square + 8 : target_square - 8;
+				if(behind >= 0 && behind < 64 && piece_list[behind] == piece) {
+					candidates = 1ULL << behind;
+				} else if(behind >= 0 && behind < 64 && piece_list[behind] == E && ((1ULL << target_square) & rank_4_5[side])) {
+					candidates = pieces & (1ULL << (side ? behind + 8 : behind - 8));
+					flag = double_push;
+				}
+			}
+			break;
+		case 1:
+			candidates = knight_mask[target_square] & pieces;
+			break;
+		case 2:
+			candidates = bishop_attacks(target_square, occupancies[BOTH]) & pieces;
+			break;
+		case 3:
+			candidates = rook_attacks(target_square, occupancies[BOTH]) & pieces;
+			break;
+		case 4:
+			candidates = queen_attacks(target_square, occupancies[BOTH]) & pieces;
+			break;
+		case 5:
+			candidates = king_mask[target_square] & pieces;
+			break;
+	}
+	if(from_file >= 0) {
+		candidates &= 0x0101010101010101ULL << from_file;
+	}
+	if(from_rank >= 0) {
+		candidates &= 0xffULL << (8 * from_rank);
+	}
+
+	if((occupancies[side] >> target_square) & 1) {
+		return Move();
+	}
+
+	// Candidates are pseudo-legal, drop the ones that would leave the king in check (notation also
+	// leaves out disambiguation when the other piece is pinned)
+	int capture = flag == en_passant ? WP + !side : piece_list[target_square];
+	Move move;
+	int legal = 0;
+	for(; candidates; candidates &= candidates - 1) {
+		Move candidate (lsb(candidates), target_square, piece, capture, promote, flag);
+		if(is_legal(candidate)) {
+			move = candidate;
+			legal++;
+		}
+	}
+	return legal == 1 ? move : Move();
 }
 
 // Modifies all applicable occupancies
@@ -406,6 +748,11 @@ void Board::set_square(int square, int piece) {
 	piece_list[square] = piece;
 	occupancies[BOTH] |= occupancy_modifier[piece] << square;
 	occupancies[side] = occupancies[!side] ^ occupancies[BOTH];
+	hash_key ^= zobrist_pieces[piece][square];
+	material_key += material_increment[piece];
+	if(incremental_attacks && piece != E) {
+		update_attacks(square, piece, true);
+	}
 }
 
 void Board::remove_square(int square, int piece) {
@@ -413,16 +760,27 @@ void Board::remove_square(int square, int piece) {
 	piece_list[square] = E;
 	occupancies[BOTH] &= ~(1ULL << square);
 	occupancies[side] = occupancies[side] & occupancies[BOTH];
+	hash_key ^= zobrist_pieces[piece][square];
+	material_key -= material_increment[piece];
+	if(incremental_attacks && piece != E) {
+		update_attacks(square, piece, false);
+	}
 }
 
 // Make a move
 void Board::make_move(Move move) {
+	count(STAT_MAKE_MOVES);
 	int source_square = move.source();
 	int target_square = move.target();
 	int piece = move.piece();
 	int capture = move.capture();
+	key_history.push_back(hash_key);
+	hash_key ^= zobrist_castling[castling_rights.back()] ^ zobrist_en_passant[en_passant_square.back()];
 	en_passant_square.push_back(64);
 	castling_rights.push_back(castling_rights.back());
+	// Captures and pawn moves are irreversible
+	halfmove_clock.push_back((piece <= BP || capture != E) ? 0 : halfmove_clock.back() + 1);
+	fullmove_number += side;
 	switch(move.flag()) {
 		case none:
 			// Remove moving piece, remove possible piece from target square, set piece down
@@ -487,18 +845,25 @@ void Board::make_move(Move move) {
     	castling_rights.back() &= ~8;
   	}
 
+	hash_key ^= zobrist_castling[castling_rights.back()] ^ zobrist_en_passant[en_passant_square.back()] ^ zobrist_side;
 	side ^= 1;
 }
 
 // Unmake a move
 void Board::unmake_move(Move move) {
+	count(STAT_UNMAKE_MOVES);
+	hash_key ^= zobrist_castling[castling_rights.back()] ^ zobrist_en_passant[en_passant_square.back()] ^ zobrist_side;
 	castling_rights.pop_back();
 	en_passant_square.pop_back();
+	halfmove_clock.pop_back();
+	key_history.pop_back();
+	hash_key ^= zobrist_castling[castling_rights.back()] ^ zobrist_en_passant[en_passant_square.back()];
 	int source_square = move.source();
 	int target_square = move.target();
 	int piece = move.piece();
 	int capture = move.capture();
 	side ^= 1;
+	fullmove_number -= side;
 	switch(move.flag()) {
 		case none:
 			// Restore moving piece, possible piece from target square, and remove target square
@@ -541,6 +906,26 @@ void Board::unmake_move(Move move) {
 	}
 }
 
+// Pass the turn without moving a piece (for null move pruning)
+void Board::make_null_move() {
+	key_history.push_back(hash_key);
+	hash_key ^= zobrist_en_passant[en_passant_square.back()] ^ zobrist_side;
+	en_passant_square.push_back(64);
+	castling_rights.push_back(castling_rights.back());
+	// Repetitions are not looked for across a null move
+	halfmove_clock.push_back(0);
+	side ^= 1;
+}
+
+void Board::unmake_null_move() {
+	castling_rights.pop_back();
+	en_passant_square.pop_back();
+	halfmove_clock.pop_back();
+	key_history.pop_back();
+	hash_key ^= zobrist_en_passant[en_passant_square.back()] ^ zobrist_side;
+	side ^= 1;
+}
+
 void Board::print() {
     const std::string pieces[13] = {"♙", "♟", "♘", "♞", "♗", "♝", "♖", "♜", "♕", "♛", "♔", "♚", "."};
     int square;
@@ -619,7 +1004,33 @@ void Board::print_move(Move move) {
 	std::cout << promoted_pieces[move.promote()] << " ";
 }
 
+// Long algebraic notation used by the UCI protocol (e.g. e7e8q)
+std::string Board::move_to_uci(PackedMove move) {
+	std::string uci = coordinates[move.source()] + coordinates[move.target()];
+	if(move.promote()) {
+		uci += promoted_pieces[move.promote()];
+	}
+	return uci;
+}
+
+std::string Board::move_to_uci(Move move) {
+	return move_to_uci(PackedMove(move));
+}
+
+// Restore the full move in the current position, the packed move must belong to it
+Move Board::unpack_move(PackedMove move) {
+	int source_square = move.source();
+	int target_square = move.target();
+	int piece = piece_list[source_square];
+	int capture = move.flag() == en_passant ? (piece ^ 1) : piece_list[target_square];
+	return Move(source_square, target_square, piece, capture, move.promote(), move.flag());
+}
+
 void Board::initialize_sliding_pieces() {
+	if(!lookup_table) {
+		lookup_table = (uint64_t *)allocate_large(lookup_table_size * sizeof(uint64_t), "attack table");
+	}
+
 	// Rook bitboards
 	for(int sq = 0; sq < 64; sq++) {
 		uint64_t rook_attacks = rook_mask[sq];
@@ -683,188 +1094,397 @@ void Board::initialize_in_between() {
 	}
 }
 
-// Uses FEN string to initialize the board
-void Board::initialize_fen(std::string FEN) {
-	int i = 0;
-	int square_counter = 0;
-	int square;
-	while(FEN[i] != ' ') {
-		square = (square_counter ^ 63) ^ 7;
-		switch(FEN[i]) {
-			case 'P':
-				bitboards[WP] |= 1ULL << square;
-				piece_list[square] = WP;
-				square_counter++;
-				break;
-			case 'p':
-				bitboards[BP] |= 1ULL << square;
-				piece_list[square] = BP;
-				square_counter++;
-				break;
-			case 'N':
-				bitboards[WN] |= 1ULL << square;
-				piece_list[square] = WN;
-				square_counter++;
-				break;
-			case 'n':
-				bitboards[BN] |= 1ULL << square;
-				piece_list[square] = BN;
-				square_counter++;
-				break;
-			case 'B':
-				bitboards[WB] |= 1ULL << square;
-				piece_list[square] = WB;
-				square_counter++;
-
-				break;
-			case 'b':
-				bitboards[BB] |= 1ULL << square;
-				piece_list[square] = BB;
-				square_counter++;
-				break;
-			case 'R':
-				bitboards[WR] |= 1ULL << square;
-				piece_list[square] = WR;
-				square_counter++;
-				break;
-			case 'r':
-				bitboards[BR] |= 1ULL << square;
-				piece_list[square] = BR;
-				square_counter++;
-				break;
-			case 'Q':
-				bitboards[WQ] |= 1ULL << square;
-				piece_list[square] = WQ;
-				square_counter++;
-				break;
-			case 'q':
-				bitboards[BQ] |= 1ULL << square;
-				piece_list[square] = BQ;
-				square_counter++;
-				break;
-			case 'K':
-				bitboards[WK] |= 1ULL << square;
-				piece_list[square] = WK;
-				square_counter++;
-				break;
-			case 'k':
-				bitboards[BK] |= 1ULL << square;
-				piece_list[square] = BK;
-				square_counter++;
-				break;
-			case '1':
-				square_counter++;
-				break;
-			case '2':
-				square_counter += 2;
-				break;
-			case '3':
-				square_counter += 3;
-				break;
-			case '4':
-				square_counter += 4;
-				break;
-			case '5':
-				square_counter += 5;
-				break;
-			case '6':
-				square_counter += 6;
-				break;
-			case '7':
-				square_counter += 7;
-				break;
-			case '8':
-				square_counter += 8;
-				break;
-			case '/':
-				break;
-		}
-		i++;
+// Fill the zobrist keys with a fixed-seed xorshift generator so keys are the same on every run
+void Board::initialize_zobrist() {
+	uint64_t seed = 0x9e3779b97f4a7c15;
+	auto random_key = [&seed]() {
+		seed ^= seed >> 12;
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		return seed * 0x2545f4914f6cdd1d;
+	};
+
+	for(int piece = WP; piece <= BK; piece++) {
+		for(int square = 0; square < 64; square++) {
+			zobrist_pieces[piece][square] = random_key();
+		}
+	}
+	for(int square = 0; square < 64; square++) {
+		zobrist_pieces[E][square] = 0ULL;
+		zobrist_en_passant[square] = random_key();
+	}
+	zobrist_en_passant[64] = 0ULL;
+	for(int castle = 0; castle < 16; castle++) {
+		zobrist_castling[castle] = random_key();
+	}
+	zobrist_side = random_key();
+}
+
+// Compute the hash key of the current position from scratch
+uint64_t Board::generate_hash_key() {
+	uint64_t key = 0ULL;
+	for(int square = 0; square < 64; square++) {
+		key ^= zobrist_pieces[piece_list[square]][square];
+	}
+	key ^= zobrist_castling[castling_rights.back()];
+	key ^= zobrist_en_passant[en_passant_square.back()];
+	if(side) {
+		key ^= zobrist_side;
+	}
+	return key;
+}
+
+// Count the pieces of the current position from scratch
+uint64_t Board::generate_material_key() {
+	uint64_t key = 0ULL;
+	for(int square = 0; square < 64; square++) {
+		key += material_increment[piece_list[square]];
+	}
+	return key;
+}
+
+// Look for an earlier occurrence of the current position with the same side to move,
+// only as far back as the last irreversible move
+bool Board::is_repetition() {
+	int size = key_history.size();
+	int distance = std::min(halfmove_clock.back(), size);
+	for(int i = 4; i <= distance; i += 2) {
+		if(key_history[size - i] == hash_key) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Draw by repetition or the fifty-move rule
+bool Board::is_draw() {
+	return halfmove_clock.back() >= 100 || is_repetition();
+}
+
+// FEN letters by piece code
+const char fen_letters[13] = {'P', 'p', 'N', 'n', 'B', 'b', 'R', 'r', 'Q', 'q', 'K', 'k', '.'};
+
+// Piece code of a FEN letter, E for anything else
+inline int fen_piece(char letter) {
+	switch(letter) {
+		case 'P': return WP;
+		case 'p': return BP;
+		case 'N': return WN;
+		case 'n': return BN;
+		case 'B': return WB;
+		case 'b': return BB;
+		case 'R': return WR;
+		case 'r': return BR;
+		case 'Q': return WQ;
+		case 'q': return BQ;
+		case 'K': return WK;
+		case 'k': return BK;
+		default: return E;
+	}
+}
+
+// Read a non-negative number, false if there are no digits
+inline bool read_number(const char *&c, int &number) {
+	if(*c < '0' || *c > '9') {
+		return false;
+	}
+	number = 0;
+	while(*c >= '0' && *c <= '9') {
+		// Larger clocks are rejected, the digits left over fail the FEN
+		if(number * 10 + (*c - '0') > max_fen_clock) {
+			return false;
+		}
+		number = number * 10 + (*c++ - '0');
+	}
+	return true;
+}
+
+// Empty the board. The state vectors keep their capacity, so setting up a position does not allocate
+// once a board has been used.
+void Board::clear_position() {
+	for(int piece = WP; piece <= E; piece++) {
+		bitboards[piece] = 0ULL;
+	}
+	for(int square = 0; square < 64; square++) {
+		piece_list[square] = E;
+	}
+	castling_rights.clear();
+	en_passant_square.clear();
+	halfmove_clock.clear();
+	key_history.clear();
+}
+
+// Derive the occupancies and hash key once the pieces are placed, and reject impossible positions:
+// one king each, no pawns on the back ranks and the side that just moved is not in check
+bool Board::complete_position() {
+	occupancies[WHITE] = bitboards[WP] | bitboards[WN] | bitboards[WB] | bitboards[WR] | bitboards[WQ] | bitboards[WK];
+	occupancies[BLACK] = bitboards[BP] | bitboards[BN] | bitboards[BB] | bitboards[BR] | bitboards[BQ] | bitboards[BK];
+	occupancies[BOTH] = occupancies[WHITE] | occupancies[BLACK];
+	hash_key = generate_hash_key();
+	material_key = generate_material_key();
+	if(incremental_attacks) {
+		generate_attacks();
+	}
+
+	if(pop_count(bitboards[WK]) != 1 || pop_count(bitboards[BK]) != 1 || ((bitboards[WP] | bitboards[BP]) & 0xff000000000000ffULL)) {
+		return false;
+	}
+	// No more pieces or pawns than a game can have (which also keeps the position packable)
+	if(pop_count(occupancies[WHITE]) > 16 || pop_count(occupancies[BLACK]) > 16 || pop_count(bitboards[WP]) > 8 || pop_count(bitboards[BP]) > 8) {
+		return false;
+	}
+	side ^= 1;
+	bool illegal = in_check();
+	side ^= 1;
+	return !illegal;
+}
+
+// Uses FEN string to initialize the board, clearing any previous position first.
+// Returns false (leaving the board unusable until the next successful call) if the FEN is malformed
+// or describes an impossible position. The halfmove and fullmove fields are optional.
+bool Board::initialize_fen(const char *fen) {
+	clear_position();
+
+	// Piece placement from a8 to h1
+	const char *c = fen;
+	int rank = 7;
+	int file = 0;
+	for(; *c && *c != ' '; c++) {
+		if(*c == '/') {
+			if(file != 8 || rank == 0) {
+				return false;
+			}
+			rank--;
+			file = 0;
+		} else if(*c >= '1' && *c <= '8') {
+			file += *c - '0';
+			if(file > 8) {
+				return false;
+			}
+		} else {
+			int piece = fen_piece(*c);
+			if(piece == E || file > 7) {
+				return false;
+			}
+			int square = rank * 8 + file;
+			bitboards[piece] |= 1ULL << square;
+			piece_list[square] = piece;
+			file++;
+		}
+	}
+	if(rank != 0 || file != 8 || *c++ != ' ') {
+		return false;
 	}
 
 	// Side to move
-	i++;
-	side = 0;
-	if(FEN[i] == 'b') {
-		side = 1;
+	if(*c != 'w' && *c != 'b') {
+		return false;
+	}
+	side = *c++ == 'b';
+	if(*c++ != ' ') {
+		return false;
 	}
-	i += 2;
 
 	// Castling
 	int castling = 0;
-	while(FEN[i] != ' ') {
-		switch(FEN[i]) {
-			case 'K':
-				castling |= 1;
-				break;
-			case 'k':
-				castling |= 2;
-				break;
-			case 'Q':
-				castling |= 4;
-				break;
-			case 'q':
-				castling |= 8;
-				break;
-			case '-':
-				break;
-		}
-		i++;
+	if(*c == '-') {
+		c++;
+	} else {
+		for(; *c && *c != ' '; c++) {
+			switch(*c) {
+				case 'K':
+					castling |= 1;
+					break;
+				case 'k':
+					castling |= 2;
+					break;
+				case 'Q':
+					castling |= 4;
+					break;
+				case 'q':
+					castling |= 8;
+					break;
+				default:
+					return false;
+			}
+		}
+	}
+	// Drop rights whose king or rook has left its square
+	for(int color = WHITE; color <= BLACK; color++) {
+		if(piece_list[castling_locations[color][0]] != WK + color) {
+			castling &= ~(5 << color);
+		}
+		if(piece_list[castling_locations[color][2]] != WR + color) {
+			castling &= ~(1 << color);
+		}
+		if(piece_list[castling_locations[color][1]] != WR + color) {
+			castling &= ~(4 << color);
+		}
 	}
 	castling_rights.push_back(castling);
-	i++;
+	if(*c++ != ' ') {
+		return false;
+	}
 
-	// En Passant
-	int en_passant = 0;
-	if(FEN[i] == '-') {
-		en_passant = 64;
+	// En passant, which needs an empty square with the pushed pawn in front of it
+	int en_passant = 64;
+	if(*c == '-') {
+		c++;
 	} else {
-		switch(FEN[i]) {
-			case 'a':
-				break;
-			case 'b':
-				en_passant += 1;
-				break;
-			case 'c':
-				en_passant += 2;
-				break;
-			case 'd':
-				en_passant += 3;
-				break;
-			case 'e':
-				en_passant += 4;
-				break;
-			case 'f':
-				en_passant += 5;
-				break;
-			case 'g':
-				en_passant += 6;
-				break;
-			case 'h':
-				en_passant += 7;
-				break;
-		}
-
-		switch(FEN[i + 1]) {
-			case '3':
-				en_passant += 16;
-				break;
-			case '6':
-				en_passant += 40;
-				break;
-			default:
-				break;
+		if(c[0] < 'a' || c[0] > 'h' || c[1] != (side ? '3' : '6')) {
+			return false;
 		}
+		en_passant = (c[0] - 'a') + 8 * (c[1] - '1');
+		int pawn_square = side ? en_passant + 8 : en_passant - 8;
+		if(piece_list[en_passant] != E || piece_list[pawn_square] != WP + !side) {
+			return false;
+		}
+		c += 2;
 	}
 	en_passant_square.push_back(en_passant);
 
-	// Initialize the occupancy bitboards
-	occupancies[WHITE] = bitboards[WP] | bitboards[WN] | bitboards[WB] | bitboards[WR] | bitboards[WQ] | bitboards[WK];
-	occupancies[BLACK] = bitboards[BP] | bitboards[BN] | bitboards[BB] | bitboards[BR] | bitboards[BQ] | bitboards[BK];
-	occupancies[BOTH] = occupancies[WHITE] | occupancies[BLACK];
+	// Halfmove clock and fullmove number (optional)
+	int halfmove = 0;
+	fullmove_number = 1;
+	if(*c == ' ') {
+		c++;
+		if(read_number(c, halfmove) && *c == ' ') {
+			c++;
+			read_number(c, fullmove_number);
+		}
+	}
+	while(*c == ' ' || *c == '\r' || *c == '\n') {
+		c++;
+	}
+	if(*c) {
+		return false;
+	}
+	halfmove_clock.push_back(halfmove);
+	return complete_position();
+}
+
+// Write the position as FEN into buffer (at least max_fen_length bytes) and return its length
+int Board::to_fen(char *buffer) {
+	char *c = buffer;
+	for(int rank = 7; rank >= 0; rank--) {
+		int empty = 0;
+		for(int file = 0; file < 8; file++) {
+			int piece = piece_list[rank * 8 + file];
+			if(piece == E) {
+				empty++;
+				continue;
+			}
+			if(empty) {
+				*c++ = '0' + empty;
+				empty = 0;
+			}
+			*c++ = fen_letters[piece];
+		}
+		if(empty) {
+			*c++ = '0' + empty;
+		}
+		if(rank) {
+			*c++ = '/';
+		}
+	}
+
+	*c++ = ' ';
+	*c++ = side ? 'b' : 'w';
+	*c++ = ' ';
+	int castle = castling_rights.back();
+	if(!castle) {
+		*c++ = '-';
+	}
+	if(castle & 1) {
+		*c++ = 'K';
+	}
+	if(castle & 4) {
+		*c++ = 'Q';
+	}
+	if(castle & 2) {
+		*c++ = 'k';
+	}
+	if(castle & 8) {
+		*c++ = 'q';
+	}
+
+	*c++ = ' ';
+	int en_passant = en_passant_square.back();
+	if(en_passant == 64) {
+		*c++ = '-';
+	} else {
+		*c++ = 'a' + (en_passant & 7);
+		*c++ = '1' + (en_passant >> 3);
+	}
+
+	c += snprintf(c, max_fen_length - (c - buffer), " %d %d", halfmove_clock.back(), fullmove_number);
+	return std::min<int>(c - buffer, max_fen_length - 1);
+}
+
+// Write the position into a packed record. The score and result fields are left to the caller.
+// False, with the record untouched, when the position has more than 32 pieces.
+bool Board::pack(PackedPosition &packed) {
+	if(pop_count(occupancies[BOTH]) > 32) {
+		return false;
+	}
+	packed.occupancy = occupancies[BOTH];
+	for(int i = 0; i < 16; i++) {
+		packed.pieces[i] = 0;
+	}
+	int index = 0;
+	for(uint64_t occupancy = occupancies[BOTH]; occupancy; index++) {
+		packed.pieces[index >> 1] |= piece_list[return_lsb(occupancy)] << ((index & 1) * 4);
+	}
+	packed.state = castling_rights.back() | (side << 7);
+	packed.en_passant = en_passant_square.back();
+	packed.halfmove = std::min(halfmove_clock.back(), 255);
+	packed.fullmove = fullmove_number;
+	return true;
+}
+
+// Set up the position of a packed record, with the same checks as initialize_fen
+bool Board::unpack(const PackedPosition &packed) {
+	clear_position();
+	if(pop_count(packed.occupancy) > 32) {
+		return false;
+	}
+	int index = 0;
+	for(uint64_t occupancy = packed.occupancy; occupancy; index++) {
+		int square = return_lsb(occupancy);
+		int piece = (packed.pieces[index >> 1] >> ((index & 1) * 4)) & 15;
+		if(piece >= E) {
+			return false;
+		}
+		bitboards[piece] |= 1ULL << square;
+		piece_list[square] = piece;
+	}
+
+	side = packed.state >> 7;
+	int castling = packed.state & 15;
+	for(int color = WHITE; color <= BLACK; color++) {
+		bool king = piece_list[castling_locations[color][0]] == WK + color;
+		if(((castling & (1 << color)) && !(king && piece_list[castling_locations[color][2]] == WR + color)) ||
+			((castling & (4 << color)) && !(king && piece_list[castling_locations[color][1]] == WR + color))) {
+			return false;
+		}
+	}
+	castling_rights.push_back(castling);
+
+	int en_passant = packed.en_passant;
+	if(en_passant != 64) {
+		int pawn_square = side ? en_passant + 8 : en_passant - 8;
+		if(en_passant > 63 || (en_passant >> 3) != (side ? 2 : 5) || piece_list[en_passant] != E || piece_list[pawn_square] != WP + !side) {
+			return false;
+		}
+	}
+	en_passant_square.push_back(en_passant);
+	halfmove_clock.push_back(packed.halfmove);
+	fullmove_number = packed.fullmove;
+	return complete_position();
 }
 
 void Board::initialize() {
 	initialize_sliding_pieces();
 	initialize_in_between();
+	initialize_zobrist();
 }
@@ -4,7 +4,9 @@
 #include <cstdint>
 #include <vector>
 #include <cmath>
+#include <string>
 #include "move.h"
+#include "packed_position.h"
 
 
 // Enumerate board properties
@@ -24,6 +26,13 @@ enum squares {
     a8, b8, c8, d8, e8, f8, g8, h8
 };
 
+// Largest halfmove clock or fullmove number accepted in a FEN
+const int max_fen_clock = 9999;
+
+// Longest FEN written by to_fen, including the terminator: 71 board characters, " w KQkq e6" and
+// two clocks, which may have counted past max_fen_clock in play
+const int max_fen_length = 128;
+
 // Enumerate ray directions
 enum directions {NO, NE, EA, SE, SO, SW, WE, NW};
 
@@ -34,7 +43,16 @@ public:
     void initialize_sliding_pieces();
     void initialize();
     void initialize_in_between();
-    void initialize_fen(std::string fen);
+    void initialize_zobrist();
+    bool initialize_fen(const char *fen);
+    bool initialize_fen(const std::string &fen) {
+        return initialize_fen(fen.c_str());
+    }
+    int to_fen(char *buffer);
+    bool pack(PackedPosition &packed);
+    bool unpack(const PackedPosition &packed);
+    void clear_position();
+    bool complete_position();
 
     // Representing board state
     uint64_t bitboards [13];
@@ -51,13 +69,41 @@ public:
     };
     std::vector<int> castling_rights;
     std::vector<int> en_passant_square;
+    std::vector<int> halfmove_clock; // Plies since the last capture or pawn move
     bool side;
+    int fullmove_number;
+
+    // Zobrist hashing, updated incrementally while making moves
+    uint64_t hash_key;
+    uint64_t zobrist_pieces [13] [64]; // Empty square keys are zero
+    uint64_t zobrist_castling [16];
+    uint64_t zobrist_en_passant [65]; // No en passant square (64) is zero
+    uint64_t zobrist_side;
+    uint64_t generate_hash_key();
+
+    // Piece counts in 4 bits per piece code (kings are not counted), updated with the squares
+    uint64_t material_key;
+    static constexpr uint64_t material_increment[13] = {
+        1ULL << 0, 1ULL << 4, 1ULL << 8, 1ULL << 12, 1ULL << 16, 1ULL << 20, 1ULL << 24, 1ULL << 28, 1ULL << 32, 1ULL << 36, 0, 0, 0
+    };
+    uint64_t generate_material_key();
+    int piece_count(int piece) {
+        return (material_key >> (4 * piece)) & 15;
+    }
+
+    // Keys of the positions before each move, across game moves and search plies
+    std::vector<uint64_t> key_history;
+    bool is_repetition();
+    bool is_draw();
 
     // Display purposes
     void print();
     void print_bits(uint64_t bitboard);
     void print_moves(std::vector<Move> move_list);
     void print_move(Move move);
+    std::string move_to_uci(Move move);
+    std::string move_to_uci(PackedMove move);
+    Move unpack_move(PackedMove move);
 
     // Classical sliding piece attacks for magic bitboards
     uint64_t positive_ray_attacks (int square, int direction, uint64_t occupancy);
@@ -77,13 +123,19 @@ public:
     // Move generation
     void legal_moves(std::vector<Move> &move_list);
     void legal_captures(std::vector<Move> &move_list);
+    void pseudo_legal_moves(std::vector<Move> &move_list);
+    void pseudo_legal_captures(std::vector<Move> &move_list);
+    bool is_legal(Move move);
+    Move resolve_move(int piece, int target_square, int from_file, int from_rank, int promote);
 
     // Making and unamking moves
     void make_move(Move move);
     void unmake_move(Move move);
+    void make_null_move();
+    void unmake_null_move();
     void set_square(int square, int piece);
     // To account for the adding of useless bits
-    const uint64_t occupancy_modifier[13] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0};
+    static constexpr uint64_t occupancy_modifier[13] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0};
     void remove_square(int square, int piece);
 
     // Other functions and arrays concerning move generation
@@ -91,36 +143,50 @@ public:
     uint64_t x_ray_rook_attacks(int square, uint64_t occupancy, uint64_t blockers);
     uint64_t x_ray_bishop_attacks(int square, uint64_t occupancy, uint64_t blockers);
     uint64_t attacks_to_square(int square);
+    uint64_t attacks_to_square(int square, uint64_t occupancy);
     uint64_t absolute_pins(int square);
     uint64_t attack_map(uint64_t occupancy);
+    uint64_t piece_attacks(int piece, int square, uint64_t occupancy);
+    bool in_check();
+
+    // Optional attack tables kept up to date by set_square and remove_square: the squares each piece
+    // attacks and the pieces attacking each square (as source squares, both colors). A change only
+    // rescans the piece itself and the sliders whose rays pass through the changed square.
+    bool incremental_attacks = false;
+    uint64_t piece_attack_sets [64];
+    uint64_t square_attackers [64];
+    void set_incremental_attacks(bool enabled);
+    void generate_attacks();
+    void update_attacks(int square, int piece, bool placed);
+    uint64_t king_attack_map(int king_square, uint64_t checkers);
 
     // For special move flags (promotion, double pawn push and  castling)
-    const uint64_t promotion_ranks [2] = {
+    static constexpr uint64_t promotion_ranks [2] = {
         0xff000000000000,
         0xff00
     };
 
-    const uint64_t rank_2_7 [2] = {
+    static constexpr uint64_t rank_2_7 [2] = {
         0xff00,
         0xff000000000000
     };
 
-    const uint64_t rank_4_5 [2] = {
+    static constexpr uint64_t rank_4_5 [2] = {
         0xff000000,
         0xff00000000
     };
 
-    const int castling_locations [2] [5] = {
+    static constexpr int castling_locations [2] [5] = {
         {e1, a1, h1, g1, c1},
         {e8, a8, h8, g8, c8}
     };
 
-    const uint64_t castling_check_mask [2] [2] = {
+    static constexpr uint64_t castling_check_mask [2] [2] = {
         {0x60, 0xc},
         {0x6000000000000000, 0xc00000000000000}
     };
 
-    const uint64_t castling_occupancy_mask [2] [2] = {
+    static constexpr uint64_t castling_occupancy_mask [2] [2] = {
         {0x60, 0xe},
         {0x6000000000000000, 0xe00000000000000}
     };
@@ -0,0 +1,46 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <string>
+#include "board.h"
+
+// Opening book in the Polyglot .bin format: 16 byte big-endian entries sorted by key
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+// Polyglot hash of a position (independent of the board's own zobrist keys)
+uint64_t polyglot_key(Board &board);
+
+// Polyglot move encoding: to file/rank, from file/rank, promotion (1-4 for N, B, R, Q).
+// Castling is written as the king capturing its own rook.
+uint16_t polyglot_move(Move move);
+
+// Read-only book memory-mapped from disk, probed with a binary search over its entries
+class Book {
+public:
+    ~Book();
+
+    const unsigned char *data = nullptr;
+    uint64_t size = 0;
+    uint64_t entries = 0;
+    bool weighted = false; // Pick randomly by weight instead of always the heaviest move
+
+    bool open(std::string path);
+    void close();
+    bool is_open() {
+        return data != nullptr;
+    }
+
+    BookEntry entry(uint64_t index);
+    uint64_t lower_bound(uint64_t key);
+
+    // Book move for the position, or an empty move when out of book
+    Move probe(Board &board);
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include "book_builder.h"
+#include "book.h"
+#include "pgn.h"
+#include "uci.h"
+
+bool record_less(const BookRecord &a, const BookRecord &b) {
+	return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+
+// Shared state of a build, only touched when a file is taken or a run is written
+struct BuildState {
+	BookBuildSettings *settings;
+	std::atomic<int> next_file;
+	std::atomic<uint64_t> games;
+	std::atomic<uint64_t> errors;
+	std::atomic<uint64_t> records;
+	std::atomic<bool> failed;
+	std::mutex runs_mutex;
+	std::vector<std::string> runs;
+};
+
+// Sort a full buffer and spill it to disk as one run
+void write_run(BuildState &state, std::vector<BookRecord> &buffer) {
+	if(buffer.empty()) {
+		return;
+	}
+	std::sort(buffer.begin(), buffer.end(), record_less);
+
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(state.runs_mutex);
+		path = state.settings->output + ".run" + std::to_string(state.runs.size());
+		state.runs.push_back(path);
+	}
+	FILE *file = fopen(path.c_str(), "wb");
+	bool written = file && fwrite(buffer.data(), sizeof(BookRecord), buffer.size(), file) == buffer.size();
+	if(file && fclose(file) != 0) {
+		written = false;
+	}
+	if(!written) {
+		std::cerr << "could not write " << path << "\n";
+		state.failed = true;
+	}
+	state.records += buffer.size();
+	buffer.clear();
+}
+
+void build_worker(BuildState &state, Board board, uint64_t capacity) {
+	BookBuildSettings &settings = *state.settings;
+	std::vector<BookRecord> buffer;
+	buffer.reserve(capacity);
+
+	for(int index = state.next_file++; index < settings.inputs.size(); index = state.next_file++) {
+		PgnReader reader;
+		if(!reader.open(settings.inputs[index])) {
+			std::cerr << "could not open " << settings.inputs[index] << "\n";
+			continue;
+		}
+
+		int ply = 0;
+		auto visit = [&](Board &position, Move move) {
+			if(ply++ >= settings.max_ply || reader.result == UNKNOWN_RESULT) {
+				return false;
+			}
+			uint8_t result = position.side == WHITE ? reader.result : 2 - reader.result;
+			buffer.push_back({polyglot_key(position), polyglot_move(move), result});
+			if(buffer.size() >= capacity) {
+				write_run(state, buffer);
+			}
+			return true;
+		};
+		while(reader.next_game(board, visit)) {
+			ply = 0;
+		}
+		state.games += reader.games;
+		state.errors += reader.errors;
+	}
+	write_run(state, buffer);
+}
+
+// Statistics of one move while merging
+struct MoveCount {
+	uint16_t move;
+	uint32_t results [3]; // Losses, draws, wins
+};
+
+// Write the moves of one position: weight is 2 per win and 1 per draw, scaled to 16 bits.
+// False when the book could not be written.
+bool write_position(FILE *book, uint64_t key, std::vector<MoveCount> &moves, int min_games) {
+	uint64_t max_points = 0;
+	for(int i = 0; i < moves.size(); i++) {
+		max_points = std::max<uint64_t>(max_points, 2ULL * moves[i].results[2] + moves[i].results[1]);
+	}
+	std::vector<BookEntry> entries;
+	for(int i = 0; i < moves.size(); i++) {
+		uint64_t games = (uint64_t)moves[i].results[0] + moves[i].results[1] + moves[i].results[2];
+		uint64_t points = 2ULL * moves[i].results[2] + moves[i].results[1];
+		uint64_t weight = max_points > 65535 ? points * 65535 / max_points : points;
+		if(games >= min_games && weight > 0) {
+			entries.push_back({key, moves[i].move, (uint16_t)weight, 0});
+		}
+	}
+	// Polyglot books list the heaviest move first
+	std::sort(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b) {
+		return a.weight > b.weight;
+	});
+	for(int i = 0; i < entries.size(); i++) {
+		uint64_t entry_key = __builtin_bswap64(entries[i].key);
+		uint16_t move = __builtin_bswap16(entries[i].move);
+		uint16_t weight = __builtin_bswap16(entries[i].weight);
+		uint32_t learn = 0;
+		unsigned char bytes [16];
+		memcpy(bytes, &entry_key, 8);
+		memcpy(bytes + 8, &move, 2);
+		memcpy(bytes + 10, &weight, 2);
+		memcpy(bytes + 12, &learn, 4);
+		if(fwrite(bytes, 16, 1, book) != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// K-way merge of the sorted runs, aggregating equal (key, move) records on the fly.
+// The record buffer budget is reused for the read buffers, split evenly across the runs.
+bool merge_runs(std::vector<std::string> &runs, BookBuildSettings &settings, uint64_t &positions) {
+	uint64_t buffer_size = std::max<uint64_t>(4096, ((uint64_t)settings.memory << 20) / std::max<size_t>(1, runs.size()));
+	std::vector<FILE *> files;
+	std::vector<std::vector<char>> buffers(runs.size());
+	typedef std::pair<BookRecord, int> Head;
+	auto greater = [](const Head &a, const Head &b) {
+		return record_less(b.first, a.first);
+	};
+	std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+	bool merged = true;
+	for(int i = 0; i < runs.size(); i++) {
+		files.push_back(fopen(runs[i].c_str(), "rb"));
+		if(!files[i]) {
+			std::cerr << "could not read " << runs[i] << "\n";
+			merged = false;
+			continue;
+		}
+		buffers[i].resize(buffer_size);
+		setvbuf(files[i], buffers[i].data(), _IOFBF, buffers[i].size());
+		BookRecord record;
+		if(fread(&record, sizeof(BookRecord), 1, files[i]) == 1) {
+			heads.push({record, i});
+		}
+	}
+
+	FILE *book = merged ? fopen(settings.output.c_str(), "wb") : nullptr;
+	if(merged && !book) {
+		std::cerr << "could not write " << settings.output << "\n";
+		merged = false;
+	}
+	positions = 0;
+	uint64_t key = 0;
+	std::vector<MoveCount> moves;
+	while(merged && !heads.empty()) {
+		Head head = heads.top();
+		heads.pop();
+		BookRecord &record = head.first;
+		if(record.key != key || moves.empty()) {
+			if(!moves.empty()) {
+				merged = write_position(book, key, moves, settings.min_games);
+				positions++;
+			}
+			key = record.key;
+			moves.clear();
+		}
+		if(moves.empty() || moves.back().move != record.move) {
+			moves.push_back({record.move, {0, 0, 0}});
+		}
+		moves.back().results[record.result]++;
+
+		BookRecord next;
+		if(fread(&next, sizeof(BookRecord), 1, files[head.second]) == 1) {
+			heads.push({next, head.second});
+		}
+	}
+	if(merged && !moves.empty()) {
+		merged = write_position(book, key, moves, settings.min_games);
+		positions++;
+	}
+	for(int i = 0; i < files.size(); i++) {
+		if(files[i]) {
+			if(ferror(files[i])) {
+				std::cerr << "could not read " << runs[i] << "\n";
+				merged = false;
+			}
+			fclose(files[i]);
+		}
+		remove(runs[i].c_str());
+	}
+	if(book && (fclose(book) != 0 || !merged)) {
+		std::cerr << "could not write " << settings.output << "\n";
+		remove(settings.output.c_str());
+		merged = false;
+	}
+	return merged;
+}
+
+bool build_book(Board &board, BookBuildSettings &settings) {
+	auto start = std::chrono::steady_clock::now();
+	BuildState state;
+	state.settings = &settings;
+	state.next_file = 0;
+	state.games = 0;
+	state.errors = 0;
+	state.records = 0;
+	state.failed = false;
+
+	int threads = std::max(1, std::min(settings.threads, (int)settings.inputs.size()));
+	uint64_t capacity = std::max<uint64_t>(1024, ((uint64_t)settings.memory << 20) / sizeof(BookRecord) / threads);
+	std::vector<std::thread> workers;
+	for(int i = 0; i < threads; i++) {
+		workers.emplace_back(build_worker, std::ref(state), board, capacity);
+	}
+	for(int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+
+	double replay_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "games " << state.games << " unreadable " << state.errors << " records " << state.records << " runs " << state.runs.size();
+	std::cout << " time " << replay_seconds << "s games/s " << (uint64_t)(state.games / std::max(replay_seconds, 1e-9)) << std::endl;
+
+	if(state.failed) {
+		for(int i = 0; i < state.runs.size(); i++) {
+			remove(state.runs[i].c_str());
+		}
+		return false;
+	}
+	uint64_t positions = 0;
+	if(!merge_runs(state.runs, settings, positions)) {
+		return false;
+	}
+	double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "positions " << positions << " written to " << settings.output << " total time " << total_seconds << "s" << std::endl;
+	return true;
+}
+
+bool test_book(Board &board, std::string directory) {
+	// Moves from the start position and the keys listed with the format
+	const std::pair<const char *, uint64_t> key_tests [] = {
+		{"", 0x463b96181691fc9cULL},
+		{"e2e4", 0x823c9b50fd114196ULL},
+		{"e2e4 d7d5", 0x0756b94461c50fb0ULL},
+		{"e2e4 d7d5 e4e5", 0x662fafb965db29d4ULL},
+		{"e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78ULL},
+		{"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652a607ca3f242c1ULL},
+		{"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00fdd303c946bdd9ULL},
+		{"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3c8123ea7b067637ULL},
+		{"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a2", 0x5c3f9b829b279560ULL},
+	};
+	bool passed = true;
+	for(auto &test : key_tests) {
+		board.initialize_fen(start_position);
+		std::istringstream moves(test.first);
+		std::string token;
+		while(moves >> token) {
+			board.make_move(parse_move(board, token));
+		}
+		uint64_t key = polyglot_key(board);
+		if(key != test.second) {
+			std::cout << "key after \"" << test.first << "\" is " << std::hex << key << " instead of " << test.second << std::dec << "\n";
+			passed = false;
+		}
+	}
+
+	// Every entry of the random table, read back through polyglot_key as the change one piece-square,
+	// castling right, en passant file or the side to move makes to a key. The entries must differ and
+	// hash, in table order (FNV-1a over whole entries), to the checksum of the table that gives the keys above.
+	std::vector<uint64_t> entries;
+	board.initialize_fen(start_position);
+	uint64_t base = polyglot_key(board);
+	for(int kind = 0; kind < 12; kind++) {
+		for(int square = 0; square < 64; square++) {
+			board.bitboards[kind ^ 1] ^= 1ULL << square;
+			entries.push_back(polyglot_key(board) ^ base);
+			board.bitboards[kind ^ 1] ^= 1ULL << square;
+		}
+	}
+	const int castling_bits [4] = {1, 4, 2, 8};
+	for(int bit : castling_bits) {
+		board.castling_rights.back() ^= bit;
+		entries.push_back(polyglot_key(board) ^ base);
+		board.castling_rights.back() ^= bit;
+	}
+	// White pawns along the fifth rank, so an en passant square on any file has a capturer beside it
+	board.initialize_fen("4k3/8/8/PPPPPPPP/8/8/8/4K3 w - - 0 1");
+	base = polyglot_key(board);
+	for(int file = 0; file < 8; file++) {
+		board.en_passant_square.back() = a6 + file;
+		entries.push_back(polyglot_key(board) ^ base);
+	}
+	board.en_passant_square.back() = 64;
+	board.side ^= 1;
+	entries.push_back(polyglot_key(board) ^ base);
+	board.side ^= 1;
+
+	uint64_t checksum = 0xcbf29ce484222325ULL;
+	for(uint64_t entry : entries) {
+		checksum = (checksum ^ entry) * 0x100000001b3ULL;
+	}
+	std::vector<uint64_t> sorted = entries;
+	std::sort(sorted.begin(), sorted.end());
+	if(std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end() || sorted[0] == 0 || checksum != 0x55f2703386bc3f61ULL) {
+		std::cout << "random table of " << entries.size() << " entries has checksum " << std::hex << checksum << std::dec << "\n";
+		passed = false;
+	}
+
+	// White scores best with 1. e4, Black answers it best with 1... c5, and castling is stored king takes rook
+	BookBuildSettings settings;
+	settings.output = directory + "/booktest.bin";
+	settings.inputs.push_back(directory + "/booktest.pgn");
+	settings.memory = 1;
+	std::ofstream games(settings.inputs[0]);
+	games << "[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5 4. O-O 1-0\n\n";
+	games << "[Result \"0-1\"]\n\n1. e4 c5 0-1\n\n";
+	games << "[Result \"1/2-1/2\"]\n\n1. d4 d5 1/2-1/2\n\n";
+	games.close();
+	board.initialize_fen(start_position);
+	if(!build_book(board, settings)) {
+		passed = false;
+	}
+
+	const std::pair<const char *, const char *> probe_tests [] = {
+		{"", "e2e4"},
+		{"e2e4", "c7c5"},
+		{"e2e4 e7e5 g1f3 b8c6 f1c4 f8c5", "e1g1"},
+		{"e2e4 c7c5", ""},
+	};
+	Book book;
+	if(!book.open(settings.output)) {
+		std::cout << "could not open " << settings.output << "\n";
+		passed = false;
+	}
+	for(auto &test : probe_tests) {
+		board.initialize_fen(start_position);
+		std::istringstream moves(test.first);
+		std::string token;
+		while(moves >> token) {
+			board.make_move(parse_move(board, token));
+		}
+		Move move = book.probe(board);
+		std::string found = move == Move() ? "" : board.move_to_uci(move);
+		if(book.is_open() && found != test.second) {
+			std::cout << "book move after \"" << test.first << "\" is \"" << found << "\" instead of \"" << test.second << "\"\n";
+			passed = false;
+		}
+	}
+	book.close();
+	remove(settings.inputs[0].c_str());
+	remove(settings.output.c_str());
+	board.initialize_fen(start_position);
+
+	std::cout << (passed ? "book test passed" : "book test failed") << std::endl;
+	return passed;
+}
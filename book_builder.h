@@ -0,0 +1,34 @@
+#ifndef BOOK_BUILDER_H
+#define BOOK_BUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "board.h"
+
+// One position/move pair seen in a game, with the result from the moving side's point of view
+struct BookRecord {
+    uint64_t key;
+    uint16_t move;
+    uint8_t result; // 2 win, 1 draw, 0 loss
+};
+
+struct BookBuildSettings {
+    std::string output;
+    std::vector<std::string> inputs;
+    int max_ply = 24;
+    int min_games = 1;
+    int memory = 256; // Megabytes for record buffers across all threads, and for read buffers while merging
+    int threads = 1;
+};
+
+// Build a Polyglot book from PGN files: games are replayed in parallel (one file per thread at a time),
+// records are sorted in memory-bounded runs on disk and merged into the book in a single pass.
+// False when a run or the book could not be written.
+bool build_book(Board &board, BookBuildSettings &settings);
+
+// Check polyglot_key against the reference keys of the Polyglot format, then build a book from
+// a few games in the given directory and probe it back. True when everything matches.
+bool test_book(Board &board, std::string directory);
+
+#endif
@@ -0,0 +1,268 @@
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include "datagen.h"
+#include "search.h"
+#include "pgn.h"
+#include "uci.h"
+
+// Games are written once a thread's buffer reaches this size
+const uint64_t game_buffer_size = 1 << 20;
+
+// Adjudication: a side is winning after this many plies in a row beyond the margin
+const int win_adjudication_score = 2500;
+const int win_adjudication_plies = 4;
+const int max_game_plies = 400;
+
+// Per-thread counters, padded so threads do not share cache lines
+struct alignas(64) DatagenProgress {
+	std::atomic<uint64_t> games;
+	std::atomic<uint64_t> positions;
+};
+
+// Mix the seed, thread and game number into the seed of one game
+uint64_t game_seed(uint64_t seed, int thread, uint64_t game) {
+	uint64_t x = seed + 0x9e3779b97f4a7c15ULL * (((uint64_t)thread << 40) + game + 1);
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+// Cut a thread's file after its last complete chunk and return the number of games it holds
+uint64_t recover_games(std::string path) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if(!file) {
+		return 0;
+	}
+	uint64_t games = 0;
+	uint64_t valid = 0;
+	GameChunkHeader header;
+	while(fread(&header, sizeof(header), 1, file) == 1 && header.magic == game_chunk_magic) {
+		if(fseeko(file, header.bytes, SEEK_CUR) != 0) {
+			break;
+		}
+		// Seeking past the end succeeds, so compare with the real size
+		off_t end = ftello(file);
+		fseeko(file, 0, SEEK_END);
+		if(ftello(file) < end) {
+			break;
+		}
+		fseeko(file, end, SEEK_SET);
+		games += header.games;
+		valid = end;
+	}
+	fclose(file);
+	if(truncate(path.c_str(), valid) != 0) {
+		std::cerr << "could not truncate " << path << "\n";
+	}
+	return games;
+}
+
+bool write_chunk(FILE *file, std::vector<uint8_t> &buffer, uint32_t games) {
+	GameChunkHeader header = {game_chunk_magic, games, buffer.size()};
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	success = fflush(file) == 0 && success;
+	buffer.clear();
+	return success;
+}
+
+// Play the random opening, false if the game ended during it
+bool play_opening(Board &board, std::mt19937_64 &random, int plies, std::vector<Move> &move_list) {
+	board.initialize_fen(start_position);
+	for(int ply = 0; ply < plies; ply++) {
+		board.legal_moves(move_list);
+		if(move_list.empty()) {
+			return false;
+		}
+		board.make_move(move_list[random() % move_list.size()]);
+	}
+	board.legal_moves(move_list);
+	return !move_list.empty() && !board.is_draw();
+}
+
+// Play one game and append it to the buffer, returns the number of recorded positions
+uint64_t play_game(Search &search, DatagenSettings &settings, std::mt19937_64 &random, uint64_t game, std::vector<uint8_t> &buffer) {
+	Board &board = search.board;
+	std::vector<Move> move_list;
+	PackedPosition start;
+	while(!play_opening(board, random, settings.random_plies + (game & 1), move_list) || !board.pack(start));
+	start.score = 0;
+
+	std::vector<GameMove> moves;
+	search.tt->clear();
+	search.clear();
+	int result = DRAW;
+	int winning_plies = 0;
+	for(int ply = 0; ply < max_game_plies; ply++) {
+		board.legal_moves(move_list);
+		if(move_list.empty()) {
+			result = board.in_check() ? (board.side == WHITE ? BLACK_WIN : WHITE_WIN) : DRAW;
+			break;
+		}
+		if(board.is_draw() || (board.occupancies[BOTH] == (board.bitboards[WK] | board.bitboards[BK]))) {
+			break;
+		}
+
+		search.stop = false;
+		Move move = search.start();
+		int score = search.best_score;
+		bool quiet = !board.in_check() && move.capture() == E && !move.promote() && abs(score) < MATE_SCORE - MAX_PLY;
+		moves.push_back({PackedMove(move).move, quiet ? (int16_t)score : skipped_score});
+
+		// Adjudicate clearly decided games
+		winning_plies = abs(score) >= win_adjudication_score ? winning_plies + 1 : 0;
+		if(winning_plies >= win_adjudication_plies) {
+			bool white_winning = (score > 0) == (board.side == WHITE);
+			result = white_winning ? WHITE_WIN : BLACK_WIN;
+			break;
+		}
+		board.make_move(move);
+	}
+
+	start.result = result;
+	moves.push_back({0, 0});
+	const uint8_t *bytes = (const uint8_t *)&start;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(start));
+	bytes = (const uint8_t *)moves.data();
+	buffer.insert(buffer.end(), bytes, bytes + moves.size() * sizeof(GameMove));
+	return moves.size() - 1;
+}
+
+void datagen_worker(DatagenSettings &settings, Board &board, int thread, DatagenProgress &progress) {
+	std::string path = settings.output + "." + std::to_string(thread);
+	uint64_t game = recover_games(path);
+	progress.games = game;
+	FILE *file = fopen(path.c_str(), "ab");
+	if(!file) {
+		std::cerr << "could not open " << path << "\n";
+		return;
+	}
+
+	TranspositionTable tt;
+	tt.resize(settings.hash);
+	std::unique_ptr<Search> search(new Search());
+	search->board = board;
+	search->tt = &tt;
+	search->quiet = true;
+	// Without any limit every move would be searched forever
+	if(settings.depth || !settings.nodes) {
+		search->limits.depth = settings.depth ? settings.depth : 8;
+	}
+	search->limits.nodes = settings.nodes;
+
+	std::vector<uint8_t> buffer;
+	buffer.reserve(game_buffer_size + 4096);
+	uint32_t buffered_games = 0;
+	for(; game < settings.games; game++) {
+		std::mt19937_64 random(game_seed(settings.seed, thread, game));
+		progress.positions += play_game(*search, settings, random, game, buffer);
+		buffered_games++;
+		if(buffer.size() >= game_buffer_size || game + 1 == settings.games) {
+			if(!write_chunk(file, buffer, buffered_games)) {
+				std::cerr << "could not write " << path << "\n";
+				break;
+			}
+			progress.games += buffered_games;
+			buffered_games = 0;
+		}
+	}
+	fclose(file);
+}
+
+void generate_data(Board &board, DatagenSettings &settings) {
+	auto start = std::chrono::steady_clock::now();
+	int threads = std::max(1, settings.threads);
+	std::unique_ptr<DatagenProgress[]> progress(new DatagenProgress[threads]);
+	std::vector<std::thread> workers;
+	for(int i = 0; i < threads; i++) {
+		progress[i].games = 0;
+		progress[i].positions = 0;
+		workers.emplace_back(datagen_worker, std::ref(settings), std::ref(board), i, std::ref(progress[i]));
+	}
+
+	// Report written games every minute while the threads run
+	auto report = [&]() {
+		uint64_t games = 0;
+		uint64_t positions = 0;
+		for(int i = 0; i < threads; i++) {
+			games += progress[i].games;
+			positions += progress[i].positions;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "games " << games << " / " << settings.games * threads << " positions " << positions;
+		std::cout << " time " << (uint64_t)seconds << "s positions/s " << (uint64_t)(positions / std::max(seconds, 1e-9)) << std::endl;
+	};
+	std::atomic<bool> finished(false);
+	std::thread reporter([&]() {
+		for(int waited = 1; !finished; waited++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			if(waited % 600 == 0) {
+				report();
+			}
+		}
+	});
+	for(int i = 0; i < threads; i++) {
+		workers[i].join();
+	}
+	finished = true;
+	reporter.join();
+	report();
+}
+
+uint64_t expand_games(Board &board, std::vector<std::string> &inputs, std::string output) {
+	PositionWriter writer;
+	if(!writer.open(output)) {
+		std::cout << "could not open " << output << "\n";
+		return 0;
+	}
+	std::vector<uint8_t> buffer;
+	for(std::string &input : inputs) {
+		FILE *file = fopen(input.c_str(), "rb");
+		if(!file) {
+			std::cout << "could not open " << input << "\n";
+			continue;
+		}
+		GameChunkHeader header;
+		while(fread(&header, sizeof(header), 1, file) == 1 && header.magic == game_chunk_magic) {
+			buffer.resize(header.bytes);
+			if(fread(buffer.data(), 1, header.bytes, file) != header.bytes) {
+				break;
+			}
+			const uint8_t *c = buffer.data();
+			const uint8_t *end = c + buffer.size();
+			while(c + sizeof(PackedPosition) <= end) {
+				PackedPosition position = *(const PackedPosition *)c;
+				c += sizeof(PackedPosition);
+				bool valid = board.unpack(position);
+				for(; c + sizeof(GameMove) <= end; c += sizeof(GameMove)) {
+					GameMove move = *(const GameMove *)c;
+					if(!move.move) {
+						c += sizeof(GameMove);
+						break;
+					}
+					if(!valid) {
+						continue;
+					}
+					if(move.score != skipped_score && board.pack(position)) {
+						position.score = move.score;
+						writer.write(position);
+					}
+					PackedMove played;
+					played.move = move.move;
+					board.make_move(board.unpack_move(played));
+				}
+			}
+		}
+		fclose(file);
+	}
+	if(!writer.close()) {
+		std::cout << "could not write " << output << "\n";
+	}
+	board.initialize_fen(start_position);
+	return writer.written;
+}
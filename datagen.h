@@ -0,0 +1,49 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "board.h"
+
+// Self-play games are stored compactly: the position after the random opening as a PackedPosition
+// (carrying the game result), then one GameMove per move played and a zero move to end the game.
+// Each thread appends chunks of whole games to its own file, <output>.<thread>.
+struct GameMove {
+    uint16_t move;  // PackedMove played
+    int16_t score;  // Search score for the side to move, or skipped_score
+};
+static_assert(sizeof(GameMove) == 4, "GameMove must stay 4 bytes");
+
+// Positions that are not used for training (in check, best move is tactical or a mate score)
+const int16_t skipped_score = 32767;
+
+struct GameChunkHeader {
+    uint32_t magic;
+    uint32_t games;
+    uint64_t bytes; // Size of the games that follow the header
+};
+const uint32_t game_chunk_magic = 0x31434744; // "DGC1"
+
+struct DatagenSettings {
+    std::string output;
+    uint64_t games = 1000;  // Games per thread
+    int threads = 1;
+    uint64_t nodes = 5000;  // Soft node limit per move (0 for none)
+    int depth = 0;          // Depth limit per move (0 for none)
+    int random_plies = 8;   // Random opening moves, one more on odd games
+    int hash = 16;          // Transposition table megabytes per thread
+    uint64_t seed = 1;
+};
+
+// Play self-play games on every thread until each has written settings.games games. Threads share
+// nothing but read-only settings: every thread owns its search, buffer and output file.
+// Flushed chunks are the checkpoint. Running again with the same output resumes: torn chunks
+// left by an interrupted run are cut off, and game n of a thread is always played from the same
+// random seed, so a resumed run produces the same games as an uninterrupted one.
+void generate_data(Board &board, DatagenSettings &settings);
+
+// Replay game files into packed positions with score and result for every recorded position
+uint64_t expand_games(Board &board, std::vector<std::string> &inputs, std::string output);
+
+#endif
@@ -0,0 +1,49 @@
+#include "evaluate.h"
+#include "psqt.h"
+#include "bits.h"
+
+// Material plus piece-square value for every piece on every square [piece] [square]
+int mg_table[12][64];
+int eg_table[12][64];
+
+void initialize_evaluation() {
+	for(int piece = WP; piece <= BK; piece++) {
+		int type = piece >> 1;
+		for(int square = 0; square < 64; square++) {
+			// Tables are written from white's point of view with a8 first
+			int table_square = (piece & 1) ? square : square ^ 56;
+			mg_table[piece][square] = mg_value[type] + mg_pst[type][table_square];
+			eg_table[piece][square] = eg_value[type] + eg_pst[type][table_square];
+		}
+	}
+}
+
+// Tapered evaluation between middlegame and endgame scores
+int evaluate(Board &board, MaterialTable &material_table) {
+	MaterialEntry &material = material_table.probe(board);
+	if(material.evaluate) {
+		int score = material.evaluate(board, material.strong);
+		return board.side == material.strong ? score : -score;
+	}
+
+	int mg = material.mg_imbalance;
+	int eg = material.eg_imbalance;
+	for(int piece = WP; piece <= BK; piece++) {
+		uint64_t pieces = board.bitboards[piece];
+		int sign = (piece & 1) ? -1 : 1;
+		while(pieces) {
+			int square = return_lsb(pieces);
+			mg += sign * mg_table[piece][square];
+			eg += sign * eg_table[piece][square];
+		}
+	}
+
+	// Scale down the endgame score of a side that is ahead but struggles to win
+	int ahead = eg < 0;
+	int scale = material.scale_function[ahead] ? material.scale_function[ahead](board, ahead) : material.scale[ahead];
+	eg = eg * scale / scale_normal;
+
+	int phase = material.phase;
+	int score = (mg * phase + eg * (24 - phase)) / 24;
+	return board.side == WHITE ? score : -score;
+}
@@ -0,0 +1,14 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include "board.h"
+#include "material.h"
+
+// Combine material and piece-square tables into per-piece lookup tables
+void initialize_evaluation();
+
+// Static evaluation in centipawns from the side to move's perspective. Material dependent terms,
+// special endings and scale factors come from the thread's material table.
+int evaluate(Board &board, MaterialTable &material_table);
+
+#endif
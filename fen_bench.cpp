@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "fen_bench.h"
+#include "uci.h"
+
+// Positions from random legal games, sampled every few plies
+void random_corpus(Board &board, std::vector<std::string> &corpus, int count) {
+	std::mt19937_64 random(20240601);
+	std::vector<Move> move_list;
+	char fen [max_fen_length];
+	while(corpus.size() < count) {
+		board.initialize_fen(start_position);
+		for(int ply = 0; ply < 200 && corpus.size() < count; ply++) {
+			board.legal_moves(move_list);
+			if(move_list.empty() || board.is_draw()) {
+				break;
+			}
+			board.make_move(move_list[random() % move_list.size()]);
+			if(ply % 4 == 3) {
+				board.to_fen(fen);
+				corpus.push_back(fen);
+			}
+		}
+	}
+}
+
+// Drop the halfmove and fullmove fields so short FENs compare equal to their round trip
+int position_length(const std::string &fen) {
+	int fields = 0;
+	for(int i = 0; i < fen.size(); i++) {
+		if(fen[i] == ' ' && ++fields == 4) {
+			return i;
+		}
+	}
+	return fen.size();
+}
+
+void fen_benchmark(Board &board, std::string path, int count) {
+	std::vector<std::string> corpus;
+	if(path.empty()) {
+		random_corpus(board, corpus, count);
+	} else {
+		std::ifstream file(path);
+		if(!file) {
+			std::cout << "could not open " << path << "\n";
+			return;
+		}
+		std::string line;
+		while(std::getline(file, line)) {
+			if(!line.empty()) {
+				corpus.push_back(line);
+			}
+		}
+	}
+	if(corpus.empty()) {
+		return;
+	}
+
+	// Correctness pass: every FEN must parse and serialize back to its own position fields
+	char fen [max_fen_length];
+	uint64_t invalid = 0;
+	uint64_t mismatches = 0;
+	for(std::string &input : corpus) {
+		if(!board.initialize_fen(input.c_str())) {
+			invalid++;
+			continue;
+		}
+		board.to_fen(fen);
+		int length = position_length(input);
+		if(position_length(fen) != length || memcmp(fen, input.c_str(), length)) {
+			if(mismatches++ < 5) {
+				std::cout << "mismatch: " << input << " -> " << fen << "\n";
+			}
+		}
+	}
+
+	// Timed passes, repeated until each has run for a while
+	uint64_t checksum = 0;
+	auto parse_rate = [&](bool serialize) {
+		uint64_t done = 0;
+		auto start = std::chrono::steady_clock::now();
+		double seconds = 0;
+		while(seconds < 1.0) {
+			for(std::string &input : corpus) {
+				board.initialize_fen(input.c_str());
+				checksum += board.hash_key;
+				if(serialize) {
+					checksum += board.to_fen(fen);
+				}
+			}
+			done += corpus.size();
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		return done / seconds;
+	};
+	double parses = parse_rate(false);
+	double round_trips = parse_rate(true);
+	// Serialization alone, from the time difference of the two passes
+	double serializations = 1.0 / (1.0 / round_trips - 1.0 / parses);
+
+	std::cout << "positions " << corpus.size() << " invalid " << invalid << " mismatches " << mismatches << "\n";
+	std::cout << "parse " << (uint64_t)parses << " fen/s, parse+write " << (uint64_t)round_trips << " fen/s, write " << (uint64_t)serializations << " fen/s (checksum " << (checksum & 0xffff) << ")\n";
+	board.initialize_fen(start_position);
+}
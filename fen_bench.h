@@ -0,0 +1,16 @@
+#ifndef FEN_BENCH_H
+#define FEN_BENCH_H
+
+#include <string>
+#include <vector>
+#include "board.h"
+
+// Time FEN parsing and serialization over a corpus, one FEN per line of path. Without a file the
+// corpus is made of positions from random games (fixed seed, so runs are comparable).
+// Every position is also written back and compared with its input to check the round trip.
+void fen_benchmark(Board &board, std::string path, int count);
+
+// FENs of positions from random legal games, with a fixed seed
+void random_corpus(Board &board, std::vector<std::string> &corpus, int count);
+
+#endif
@@ -0,0 +1,96 @@
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "huge_pages.h"
+
+struct LargeAllocation {
+	const char *name;
+	char *memory;
+	uint64_t size;
+	int kind;
+};
+
+std::mutex large_mutex;
+std::vector<LargeAllocation> large_allocations;
+
+void *allocate_large(uint64_t size, const char *name) {
+	size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+	int kind = PAGES_RESERVED;
+	void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if(memory == MAP_FAILED) {
+		// Over-allocate and trim the ends so the region starts on a huge page boundary
+		char *mapping = (char *)mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(mapping == MAP_FAILED) {
+			return nullptr;
+		}
+		char *aligned = (char *)(((uintptr_t)mapping + huge_page_size - 1) & ~(huge_page_size - 1));
+		if(aligned > mapping) {
+			munmap(mapping, aligned - mapping);
+		}
+		munmap(aligned + size, mapping + huge_page_size - aligned);
+		memory = aligned;
+		kind = madvise(memory, size, MADV_HUGEPAGE) == 0 ? PAGES_TRANSPARENT : PAGES_NORMAL;
+	}
+	std::lock_guard<std::mutex> lock(large_mutex);
+	large_allocations.push_back({name, (char *)memory, size, kind});
+	return memory;
+}
+
+void free_large(void *memory) {
+	std::lock_guard<std::mutex> lock(large_mutex);
+	for(size_t i = 0; i < large_allocations.size(); i++) {
+		if(large_allocations[i].memory == memory) {
+			munmap(memory, large_allocations[i].size);
+			large_allocations.erase(large_allocations.begin() + i);
+			return;
+		}
+	}
+}
+
+// Transparent huge pages in [memory, memory + size), from the mappings listed in /proc/self/smaps.
+// A mapping the kernel merged with a neighbour is counted whole, capped at the table size.
+uint64_t transparent_huge_bytes(char *memory, uint64_t size) {
+	std::ifstream smaps("/proc/self/smaps");
+	std::string line;
+	bool overlaps = false;
+	uint64_t bytes = 0;
+	while(std::getline(smaps, line)) {
+		unsigned long start, end, kilobytes;
+		if(sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2) {
+			overlaps = start < (uintptr_t)memory + size && end > (uintptr_t)memory;
+		} else if(overlaps && sscanf(line.c_str(), "AnonHugePages: %lu kB", &kilobytes) == 1) {
+			bytes += kilobytes << 10;
+		}
+	}
+	return bytes < size ? bytes : size;
+}
+
+void print_large_pages(const char *prefix) {
+	const char *kind_names [] = {"normal pages", "transparent huge pages", "reserved huge pages"};
+	std::lock_guard<std::mutex> lock(large_mutex);
+	std::vector<std::string> names;
+	for(LargeAllocation &allocation : large_allocations) {
+		if(std::find(names.begin(), names.end(), allocation.name) == names.end()) {
+			names.push_back(allocation.name);
+		}
+	}
+	for(std::string &name : names) {
+		uint64_t size = 0;
+		uint64_t huge = 0;
+		int kind = PAGES_RESERVED;
+		for(LargeAllocation &allocation : large_allocations) {
+			if(name == allocation.name) {
+				size += allocation.size;
+				huge += allocation.kind == PAGES_RESERVED ? allocation.size : allocation.kind == PAGES_TRANSPARENT ? transparent_huge_bytes(allocation.memory, allocation.size) : 0;
+				kind = std::min(kind, allocation.kind);
+			}
+		}
+		printf("%s%s: %llu kB in %s, %llu kB in huge pages\n", prefix, name.c_str(), (unsigned long long)size >> 10, kind_names[kind], (unsigned long long)huge >> 10);
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,22 @@
+#ifndef HUGE_PAGES_H
+#define HUGE_PAGES_H
+
+#include <cstdint>
+
+// Tables read at random during the search (magic attacks, transposition and material tables) are
+// placed in 2 MB huge pages where the system allows it, so they need far fewer TLB entries.
+// Reserved huge pages (MAP_HUGETLB) are tried first, then a 2 MB aligned mapping advised for
+// transparent huge pages. Either way the memory is page aligned, so entries never straddle a
+// cache line, and it starts out zero.
+const uint64_t huge_page_size = 2 << 20;
+
+enum page_kinds {PAGES_NORMAL, PAGES_TRANSPARENT, PAGES_RESERVED};
+
+// Memory for a table, named for the report below. Null when no memory is left at all.
+void *allocate_large(uint64_t size, const char *name);
+void free_large(void *memory);
+
+// Per table name: the memory, what kind of pages were asked for and how much is in huge pages
+void print_large_pages(const char *prefix);
+
+#endif
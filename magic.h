@@ -3,7 +3,9 @@
 
 // Implementation of fixed-shift fancy magic bitboards from https://www.talkchess.com/forum/viewtopic.php?t=64790
 // (Volker Annuss)
-uint64_t lookup_table[88772];
+// Attack sets of every magic index, in huge pages (see huge_pages.h)
+const int lookup_table_size = 88772;
+uint64_t *lookup_table;
 
 struct MAGIC {
    uint64_t factor;
@@ -1,54 +1,292 @@
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <string>
 #include "board.h"
-#include "bits.h"
-
-uint64_t perft(Board &board, int depth) {
-    if(depth == 1) {
-        std::vector<Move> move_list = {};
-        board.legal_moves(move_list);
-        return move_list.size();
-    }
-
-    int nodes = 0;
-    std::vector<Move> move_list = {};
-    board.legal_moves(move_list);
-    for(int i = 0; i < move_list.size(); i++) {
-        board.make_move(move_list[i]);
-        nodes += perft(board, depth - 1);
-        board.unmake_move(move_list[i]);
-    }
-    return nodes;
-}
-
-void perft_split(Board &board, int depth) {
-    uint64_t total_nodes = 0;
-    uint64_t nodes;
-    std::vector<Move> move_list = {};
-    board.legal_moves(move_list);
-    std::cout<<"\n";
-    for(int i = 0; i < move_list.size(); i++) {
-        board.print_move(move_list[i]);
-        board.make_move(move_list[i]);
-        if(depth == 1) {
-          nodes = 1;
+#include "evaluate.h"
+#include "bench.h"
+#include "book.h"
+#include "analysis.h"
+#include "book_builder.h"
+#include "datagen.h"
+#include "fen_bench.h"
+#include "microbench.h"
+#include "perft.h"
+#include "tablebase.h"
+#include "tuner.h"
+#include "uci.h"
+
+// buildbook <output.bin> [-ply N] [-min N] [-memory MB] [-threads N] <games.pgn> ...
+int build_book_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: buildbook <output.bin> [-ply N] [-min N] [-memory MB] [-threads N] <games.pgn> ...\n";
+        return 1;
+    }
+    BookBuildSettings settings;
+    settings.output = argv[2];
+    for(int i = 3; i < argc; i++) {
+        std::string argument = argv[i];
+        if(argument == "-ply" && i + 1 < argc) {
+            settings.max_ply = std::stoi(argv[++i]);
+        } else if(argument == "-min" && i + 1 < argc) {
+            settings.min_games = std::stoi(argv[++i]);
+        } else if(argument == "-memory" && i + 1 < argc) {
+            settings.memory = std::stoi(argv[++i]);
+        } else if(argument == "-threads" && i + 1 < argc) {
+            settings.threads = std::stoi(argv[++i]);
         } else {
-          nodes = perft(board, depth - 1);
+            settings.inputs.push_back(argument);
         }
+    }
+    return build_book(board, settings) ? 0 : 1;
+}
 
-        std::cout << nodes << "\n";
-        total_nodes += nodes;
-        board.unmake_move(move_list[i]);
+// analyse <positions.fen|positions.bin> <output> [-depth N] [-threads N] [-hash MB]
+int analyse_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: analyse <positions.fen|positions.bin> <output> [-depth N] [-threads N] [-hash MB]\n";
+        return 1;
     }
+    AnalysisSettings settings;
+    settings.input = argv[2];
+    settings.output = argv[3];
+    settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 4; i + 1 < argc; i += 2) {
+        std::string argument = argv[i];
+        if(argument == "-depth") {
+            settings.depth = std::stoi(argv[i + 1]);
+        } else if(argument == "-threads") {
+            settings.threads = std::stoi(argv[i + 1]);
+        } else if(argument == "-hash") {
+            settings.hash = std::stoi(argv[i + 1]);
+        }
+    }
+    return analyse_positions(board, settings) ? 0 : 1;
+}
 
-    std::cout << "total nodes: " << total_nodes << "\n";
+// datagen <output> [-games N] [-threads N] [-nodes N] [-depth N] [-random N] [-hash MB] [-seed N]
+int datagen_command(Board &board, int argc, char **argv) {
+    if(argc < 3) {
+        std::cout << "usage: datagen <output> [-games N] [-threads N] [-nodes N] [-depth N] [-random N] [-hash MB] [-seed N]\n";
+        return 1;
+    }
+    DatagenSettings settings;
+    settings.output = argv[2];
+    settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 3; i + 1 < argc; i += 2) {
+        std::string argument = argv[i];
+        if(argument == "-games") {
+            settings.games = std::stoull(argv[i + 1]);
+        } else if(argument == "-threads") {
+            settings.threads = std::stoi(argv[i + 1]);
+        } else if(argument == "-nodes") {
+            settings.nodes = std::stoull(argv[i + 1]);
+        } else if(argument == "-depth") {
+            settings.depth = std::stoi(argv[i + 1]);
+        } else if(argument == "-random") {
+            settings.random_plies = std::stoi(argv[i + 1]);
+        } else if(argument == "-hash") {
+            settings.hash = std::stoi(argv[i + 1]);
+        } else if(argument == "-seed") {
+            settings.seed = std::stoull(argv[i + 1]);
+        }
+    }
+    generate_data(board, settings);
+    return 0;
 }
 
-int main() {
+// expandgames <positions.bin> <games> ...: replay self-play games into packed positions
+int expand_games_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: expandgames <positions.bin> <games> ...\n";
+        return 1;
+    }
+    std::vector<std::string> inputs(argv + 3, argv + argc);
+    std::cout << "positions " << expand_games(board, inputs, argv[2]) << "\n";
+    return 0;
+}
+
+// tune <positions.bin> <output.h> [-epochs N] [-rate R] [-lambda L] [-k K] [-threads N]
+int tune_command(int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: tune <positions.bin> <output.h> [-epochs N] [-rate R] [-lambda L] [-k K] [-threads N]\n";
+        return 1;
+    }
+    TunerSettings settings;
+    settings.input = argv[2];
+    settings.output = argv[3];
+    settings.threads = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 4; i + 1 < argc; i += 2) {
+        std::string argument = argv[i];
+        if(argument == "-epochs") {
+            settings.epochs = std::stoi(argv[i + 1]);
+        } else if(argument == "-rate") {
+            settings.rate = std::stod(argv[i + 1]);
+        } else if(argument == "-lambda") {
+            settings.lambda = std::stod(argv[i + 1]);
+        } else if(argument == "-k") {
+            settings.k = std::stod(argv[i + 1]);
+        } else if(argument == "-threads") {
+            settings.threads = std::stoi(argv[i + 1]);
+        }
+    }
+    return tune_evaluation(settings) ? 0 : 1;
+}
+
+// tbgen <directory> [-threads N] <tables> ...
+int tbgen_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: tbgen <directory> [-threads N] <KQvKR | 3 | 4> ...\n";
+        return 1;
+    }
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> names;
+    for(int i = 3; i < argc; i++) {
+        std::string argument = argv[i];
+        if(argument == "-threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else {
+            names.push_back(argument);
+        }
+    }
+    return generate_tablebases(board, argv[2], names, threads) ? 0 : 1;
+}
+
+// pack <positions.fen> <positions.bin>: convert FEN lines to packed records
+int pack_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: pack <positions.fen> <positions.bin>\n";
+        return 1;
+    }
+    std::ifstream input(argv[2]);
+    PositionWriter writer;
+    if(!input || !writer.open(argv[3])) {
+        std::cout << "could not open files\n";
+        return 1;
+    }
+    std::string line;
+    uint64_t invalid = 0;
+    PackedPosition packed = {};
+    packed.result = 3; // Unknown
+    while(std::getline(input, line)) {
+        if(!board.initialize_fen(line) || !board.pack(packed)) {
+            invalid += !line.empty();
+            continue;
+        }
+        writer.write(packed);
+    }
+    bool success = writer.close();
+    if(!success) {
+        std::cout << "could not write " << argv[3] << "\n";
+    }
+    std::cout << "packed " << writer.written << " positions, skipped " << invalid << " invalid\n";
+    return success ? 0 : 1;
+}
+
+// unpack <positions.bin> <positions.fen>: convert packed records back to FEN lines
+int unpack_command(Board &board, int argc, char **argv) {
+    if(argc < 4) {
+        std::cout << "usage: unpack <positions.bin> <positions.fen>\n";
+        return 1;
+    }
+    PositionReader reader;
+    FILE *output = fopen(argv[3], "w");
+    if(!reader.open(argv[2]) || !output) {
+        std::cout << "could not open files\n";
+        return 1;
+    }
+    char fen [max_fen_length];
+    PackedPosition packed;
+    uint64_t invalid = 0;
+    while(reader.next(packed)) {
+        if(!board.unpack(packed)) {
+            invalid++;
+            continue;
+        }
+        int length = board.to_fen(fen);
+        fen[length] = '\n';
+        fwrite(fen, 1, length + 1, output);
+    }
+    fclose(output);
+    std::cout << "unpacked " << reader.size - invalid << " positions, skipped " << invalid << " invalid\n";
+    return 0;
+}
+
+// deepperft <directory> [-depth N] [-split N] [-fen FEN]: start, resume or join a checkpointed perft
+int deep_perft_command(Board &board, int argc, char **argv) {
+    if(argc < 3) {
+        std::cout << "usage: deepperft <directory> [-depth N] [-split N] [-fen FEN]\n";
+        return 1;
+    }
+    DeepPerftSettings settings;
+    settings.directory = argv[2];
+    for(int i = 3; i + 1 < argc; i += 2) {
+        std::string argument = argv[i];
+        if(argument == "-depth") {
+            settings.depth = std::stoi(argv[i + 1]);
+        } else if(argument == "-split") {
+            settings.split = std::stoi(argv[i + 1]);
+        } else if(argument == "-fen") {
+            settings.fen = argv[i + 1];
+        }
+    }
+    return deep_perft(board, settings) ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
     // Initialize board properties
     Board board;
     board.initialize();
-    board.initialize_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    initialize_evaluation();
+    board.initialize_fen(start_position);
+
+    // Command line tools, otherwise speak UCI
+    if(argc > 1 && std::string(argv[1]) == "buildbook") {
+        return build_book_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "booktest") {
+        return test_book(board, argc > 2 ? argv[2] : ".") ? 0 : 1;
+    }
+    if(argc > 1 && std::string(argv[1]) == "analyse") {
+        return analyse_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "datagen") {
+        return datagen_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "expandgames") {
+        return expand_games_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "tune") {
+        return tune_command(argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "tbgen") {
+        return tbgen_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "pack") {
+        return pack_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "unpack") {
+        return unpack_command(board, argc, argv);
+    }
+    if(argc > 1 && std::string(argv[1]) == "deepperft") {
+        return deep_perft_command(board, argc, argv);
+    }
+    // fenbench [positions.fen]
+    if(argc > 1 && std::string(argv[1]) == "fenbench") {
+        fen_benchmark(board, argc > 2 ? argv[2] : "", 100000);
+        return 0;
+    }
+
+    // bench [depth] [threads] [hash] [multipv] [legal | pseudo | both]
+    if(argc > 1 && std::string(argv[1]) == "bench") {
+        bench(board, argc > 2 ? std::atoi(argv[2]) : 10, argc > 3 ? std::atoi(argv[3]) : 1, argc > 4 ? std::atoi(argv[4]) : 16, argc > 5 ? std::atoi(argv[5]) : 1, argc > 6 ? argv[6] : "legal");
+        return 0;
+    }
+    // microbench [positions.fen] [repetitions]
+    if(argc > 1 && std::string(argv[1]) == "microbench") {
+        micro_benchmark(board, argc > 2 ? argv[2] : "", argc > 3 ? std::atoi(argv[3]) : 9);
+        return 0;
+    }
 
-    board.print();
-    perft_split(board, 6);
+    uci_loop(board);
 }
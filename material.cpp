@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstdlib>
+#include "material.h"
+#include "psqt.h"
+#include "bits.h"
+#include "huge_pages.h"
+
+// Bonus for the bishop pair
+const int mg_bishop_pair = 25;
+const int eg_bishop_pair = 45;
+
+// Added to won endings so the search prefers them to any material count
+const int known_win = 10000;
+
+int distance(int a, int b) {
+	return std::max(abs((a & 7) - (b & 7)), abs((a >> 3) - (b >> 3)));
+}
+
+// 0 in the centre to 3 on the edge
+int edge_distance(int square) {
+	int file = square & 7;
+	int rank = square >> 3;
+	return std::max(3 - std::min(file, 7 - file), 3 - std::min(rank, 7 - rank));
+}
+
+// Draws however the pieces stand
+int evaluate_draw(Board &, int) {
+	return 0;
+}
+
+// Mating material against a bare king: drive the king to the edge with the strong king close by
+int evaluate_kxk(Board &board, int strong) {
+	int score = known_win;
+	for(int piece = WP + strong; piece < WK; piece += 2) {
+		score += pop_count(board.bitboards[piece]) * eg_value[piece >> 1];
+	}
+	int strong_king = lsb(board.bitboards[WK + strong]);
+	int weak_king = lsb(board.bitboards[WK + !strong]);
+	return score + 40 * edge_distance(weak_king) + 10 * (7 - distance(strong_king, weak_king));
+}
+
+// Bishop and knight: the king can only be mated in a corner of the bishop's color
+int evaluate_kbnk(Board &board, int strong) {
+	int strong_king = lsb(board.bitboards[WK + strong]);
+	int weak_king = lsb(board.bitboards[WK + !strong]);
+	bool dark = board.bitboards[WB + strong] & 0xaa55aa55aa55aa55ULL;
+	int corner = dark ? std::min(distance(weak_king, a1), distance(weak_king, h8)) : std::min(distance(weak_king, a8), distance(weak_king, h1));
+	return known_win + eg_value[1] + eg_value[2] + 40 * (7 - corner) + 10 * (7 - distance(strong_king, weak_king));
+}
+
+// Rook against pawn: won if the strong king stops the pawn or the weak king is too far from it,
+// otherwise close depending on the race between the kings
+int evaluate_krkp(Board &board, int strong) {
+	// Seen with the pawn advancing down the board
+	int flip = strong == WHITE ? 0 : 56;
+	int strong_king = lsb(board.bitboards[WK + strong]) ^ flip;
+	int weak_king = lsb(board.bitboards[WK + !strong]) ^ flip;
+	int rook = lsb(board.bitboards[WR + strong]) ^ flip;
+	int pawn = lsb(board.bitboards[WP + !strong]) ^ flip;
+	int queening = pawn & 7;
+	int rook_value = eg_value[3];
+
+	if((strong_king & 7) == (pawn & 7) && strong_king < pawn) {
+		return rook_value - distance(strong_king, pawn);
+	}
+	if(distance(weak_king, pawn) >= 3 + (board.side != strong) && distance(weak_king, rook) >= 3) {
+		return rook_value - distance(strong_king, pawn);
+	}
+	if((weak_king >> 3) <= 2 && distance(weak_king, pawn) == 1 && (strong_king >> 3) >= 3 && distance(strong_king, pawn) > 2 + (board.side == strong)) {
+		return 32 - 4 * distance(strong_king, pawn);
+	}
+	return 80 - 4 * (distance(strong_king, pawn - 8) - distance(weak_king, pawn - 8) - distance(pawn, queening));
+}
+
+// Opposite colored bishops with only pawns besides them are hard to win
+int scale_bishops(Board &board, int) {
+	const uint64_t dark = 0xaa55aa55aa55aa55ULL;
+	bool opposite = ((board.bitboards[WB] & dark) != 0) != ((board.bitboards[BB] & dark) != 0);
+	return opposite ? 24 : scale_normal;
+}
+
+// Work out the entry of a material key
+void analyse_material(MaterialEntry &entry, uint64_t key) {
+	entry = MaterialEntry();
+	entry.key = key;
+	entry.scale[WHITE] = entry.scale[BLACK] = scale_normal;
+
+	int count [12];
+	for(int piece = WP; piece <= BK; piece++) {
+		count[piece] = (key >> (4 * piece)) & 15;
+	}
+	int phase = 0;
+	int material [2] = {0, 0};
+	int pieces [2] = {0, 0}; // Non-pawn material
+	for(int piece = WP; piece < WK; piece++) {
+		phase += phase_increment[piece >> 1] * count[piece];
+		material[piece & 1] += mg_value[piece >> 1] * count[piece];
+		if(piece >= WN) {
+			pieces[piece & 1] += mg_value[piece >> 1] * count[piece];
+		}
+	}
+	entry.phase = std::min(phase, 24);
+	int strong = material[BLACK] > material[WHITE];
+	int weak = !strong;
+	entry.strong = strong;
+
+	if(count[WB] >= 2) {
+		entry.mg_imbalance += mg_bishop_pair;
+		entry.eg_imbalance += eg_bishop_pair;
+	}
+	if(count[BB] >= 2) {
+		entry.mg_imbalance -= mg_bishop_pair;
+		entry.eg_imbalance -= eg_bishop_pair;
+	}
+
+	// Specialized evaluations
+	bool pawns = count[WP] || count[BP];
+	int knights = count[WN + strong];
+	int bishops = count[WB + strong];
+	bool heavy = count[WR + strong] || count[WQ + strong];
+	if(!pawns && pieces[WHITE] <= mg_value[2] && pieces[BLACK] <= mg_value[2]) {
+		entry.evaluate = evaluate_draw;
+	} else if(!pawns && !pieces[weak] && !heavy && !bishops && knights <= 2) {
+		entry.evaluate = evaluate_draw;
+	} else if(!pawns && !pieces[weak] && !heavy && bishops == 1 && knights == 1) {
+		entry.evaluate = evaluate_kbnk;
+	} else if(!material[weak] && !count[WP + strong] && (heavy || bishops >= 2 || (bishops && knights))) {
+		entry.evaluate = evaluate_kxk;
+	} else if(pieces[strong] == mg_value[3] && count[WR + strong] == 1 && !count[WP + strong] && !pieces[weak] && count[WP + weak] == 1) {
+		entry.evaluate = evaluate_krkp;
+	}
+
+	// Scaling of the endgame score
+	if(count[WB] == 1 && count[BB] == 1 && pieces[WHITE] == mg_value[2] && pieces[BLACK] == mg_value[2]) {
+		entry.scale_function[WHITE] = entry.scale_function[BLACK] = scale_bishops;
+	}
+	for(int color = WHITE; color <= BLACK; color++) {
+		// Without pawns a small material edge rarely wins
+		if(!count[WP + color] && pieces[color] - pieces[!color] <= mg_value[2]) {
+			entry.scale[color] = pieces[color] < mg_value[3] ? 0 : pieces[!color] <= mg_value[2] ? 4 : 14;
+		}
+	}
+}
+
+// As many entries as fill one huge page, the smallest allocation of allocate_large
+MaterialTable::MaterialTable() {
+	size = huge_page_size / sizeof(MaterialEntry);
+	table = (MaterialEntry *)allocate_large(size * sizeof(MaterialEntry), "material table");
+	if(!table) {
+		table = &spare_entry;
+		size = 1;
+	}
+	for(uint64_t i = 0; i < size; i++) {
+		table[i].key = ~0ULL;
+	}
+}
+
+MaterialTable::~MaterialTable() {
+	if(table != &spare_entry) {
+		free_large(table);
+	}
+}
+
+MaterialEntry &MaterialTable::probe(Board &board) {
+	uint64_t key = board.material_key;
+	MaterialEntry &entry = table[((unsigned __int128)(key * 0x9e3779b97f4a7c15ULL) * size) >> 64];
+	if(entry.key != key) {
+		analyse_material(entry, key);
+	}
+	return entry;
+}
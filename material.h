@@ -0,0 +1,41 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <cstdint>
+#include "board.h"
+
+// Scale factors are out of 64 (the full endgame score)
+const int scale_normal = 64;
+
+// Code for particular endings: evaluations return a score for the strong side, scaling functions
+// the factor applied to the endgame score when the strong side is ahead
+typedef int (*EndgameFunction)(Board &board, int strong);
+
+// What the material of a position alone says about its evaluation
+struct MaterialEntry {
+    uint64_t key;
+    int16_t mg_imbalance; // From white's point of view
+    int16_t eg_imbalance;
+    uint8_t phase;
+    uint8_t strong;       // Side with more material
+    uint8_t scale [2];    // Endgame scale factor when that side is ahead
+    EndgameFunction evaluate;           // Replaces the general evaluation when set
+    EndgameFunction scale_function [2]; // Position dependent scale factor when set
+};
+
+// Cache of material entries indexed by Board::material_key, one per search thread
+class MaterialTable {
+public:
+    MaterialTable();
+    ~MaterialTable();
+    MaterialTable(const MaterialTable &) = delete;
+    MaterialTable &operator=(const MaterialTable &) = delete;
+
+    MaterialEntry *table;
+    uint64_t size;
+    MaterialEntry spare_entry; // The whole table when no memory could be had
+
+    MaterialEntry &probe(Board &board);
+};
+
+#endif
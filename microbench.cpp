@@ -0,0 +1,246 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "microbench.h"
+#include "fen_bench.h"
+#include "bits.h"
+#include "uci.h"
+
+// Calls per position for the primitives that only read the board
+const int calls_per_position = 32;
+
+// User space CPU cycles of the calling thread, counted only while enabled
+struct CycleCounter {
+	int file = -1;
+
+	CycleCounter() {
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		file = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+	}
+
+	~CycleCounter() {
+		if(file >= 0) {
+			close(file);
+		}
+	}
+
+	void reset() {
+		if(file >= 0) {
+			ioctl(file, PERF_EVENT_IOC_RESET, 0);
+		}
+	}
+
+	void enable() {
+		if(file >= 0) {
+			ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	void disable() {
+		if(file >= 0) {
+			ioctl(file, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+
+	uint64_t read() {
+		uint64_t cycles = 0;
+		if(file >= 0 && ::read(file, &cycles, sizeof(cycles)) != sizeof(cycles)) {
+			cycles = 0;
+		}
+		return cycles;
+	}
+};
+
+struct PassResult {
+	double nanoseconds;
+	double cycles;
+	uint64_t calls;
+};
+
+// One pass over the corpus: setup prepares a position untimed, run makes the calls and returns how
+// many it made. The timer and counter overhead of an empty run is subtracted per position.
+PassResult time_pass(CycleCounter &counter, int positions, const std::function<void(int)> &setup, const std::function<uint64_t(int)> &run, PassResult overhead) {
+	PassResult result = {0, 0, 0};
+	counter.reset();
+	for(int i = 0; i < positions; i++) {
+		setup(i);
+		counter.enable();
+		auto start = std::chrono::steady_clock::now();
+		result.calls += run(i);
+		auto end = std::chrono::steady_clock::now();
+		counter.disable();
+		result.nanoseconds += std::chrono::duration<double, std::nano>(end - start).count() - overhead.nanoseconds;
+	}
+	result.cycles = counter.read() - overhead.cycles * positions;
+	return result;
+}
+
+void micro_benchmark(Board &board, std::string path, int repetitions) {
+	std::vector<std::string> corpus;
+	if(path.empty()) {
+		random_corpus(board, corpus, 10000);
+	} else {
+		std::ifstream file(path);
+		if(!file) {
+			std::cout << "could not open " << path << "\n";
+			return;
+		}
+		std::string line;
+		while(std::getline(file, line)) {
+			if(!line.empty()) {
+				corpus.push_back(line);
+			}
+		}
+	}
+
+	// Positions are packed so setting one up is cheap and the corpus stays small
+	std::vector<PackedPosition> positions;
+	for(std::string &fen : corpus) {
+		PackedPosition packed;
+		if(board.initialize_fen(fen) && board.pack(packed)) {
+			positions.push_back(packed);
+		}
+	}
+	if(positions.empty()) {
+		std::cout << "no valid positions\n";
+		return;
+	}
+	int count = positions.size();
+	repetitions = std::max(repetitions, 1);
+
+	// Square and occupancy of every piece in the corpus, for the sliding piece lookups
+	std::vector<uint32_t> first_piece (count + 1);
+	std::vector<std::pair<int, uint64_t>> pieces;
+	for(int i = 0; i < count; i++) {
+		first_piece[i] = pieces.size();
+		board.unpack(positions[i]);
+		for(uint64_t occupied = board.occupancies[BOTH]; occupied; occupied &= occupied - 1) {
+			pieces.push_back({lsb(occupied), board.occupancies[BOTH]});
+		}
+	}
+	first_piece[count] = pieces.size();
+
+	CycleCounter counter;
+	uint64_t checksum = 0;
+	std::vector<Move> move_list;
+	std::vector<Move> position_moves;
+	auto no_setup = [](int) {};
+	auto setup_position = [&](int i) {
+		board.unpack(positions[i]);
+	};
+
+	// Cost of the timing itself
+	PassResult overhead = {0, 0, 0};
+	PassResult empty = time_pass(counter, count, no_setup, [](int) {return (uint64_t)1;}, overhead);
+	overhead.nanoseconds = empty.nanoseconds / count;
+	overhead.cycles = empty.cycles / count;
+
+	struct Primitive {
+		std::string name;
+		std::function<void(int)> setup;
+		std::function<uint64_t(int)> run;
+	};
+	std::vector<Primitive> primitives = {
+		{"rook_attacks", no_setup, [&](int i) {
+			for(uint32_t j = first_piece[i]; j < first_piece[i + 1]; j++) {
+				checksum += board.rook_attacks(pieces[j].first, pieces[j].second);
+			}
+			return (uint64_t)(first_piece[i + 1] - first_piece[i]);
+		}},
+		{"bishop_attacks", no_setup, [&](int i) {
+			for(uint32_t j = first_piece[i]; j < first_piece[i + 1]; j++) {
+				checksum += board.bishop_attacks(pieces[j].first, pieces[j].second);
+			}
+			return (uint64_t)(first_piece[i + 1] - first_piece[i]);
+		}},
+		{"queen_attacks", no_setup, [&](int i) {
+			for(uint32_t j = first_piece[i]; j < first_piece[i + 1]; j++) {
+				checksum += board.queen_attacks(pieces[j].first, pieces[j].second);
+			}
+			return (uint64_t)(first_piece[i + 1] - first_piece[i]);
+		}},
+		{"attack_map", setup_position, [&](int) {
+			uint64_t occupancy = board.occupancies[BOTH] ^ board.bitboards[WK + board.side];
+			for(int j = 0; j < calls_per_position; j++) {
+				checksum += board.attack_map(occupancy);
+			}
+			return (uint64_t)calls_per_position;
+		}},
+		{"absolute_pins", setup_position, [&](int) {
+			int king_square = lsb(board.bitboards[WK + board.side]);
+			for(int j = 0; j < calls_per_position; j++) {
+				checksum += board.absolute_pins(king_square);
+			}
+			return (uint64_t)calls_per_position;
+		}},
+		{"attacks_to_square", setup_position, [&](int) {
+			int king_square = lsb(board.bitboards[WK + board.side]);
+			for(int j = 0; j < calls_per_position; j++) {
+				checksum += board.attacks_to_square(king_square);
+			}
+			return (uint64_t)calls_per_position;
+		}},
+		{"legal_moves", setup_position, [&](int) {
+			for(int j = 0; j < calls_per_position; j++) {
+				board.legal_moves(move_list);
+				checksum += move_list.size();
+			}
+			return (uint64_t)calls_per_position;
+		}},
+		{"make_unmake", [&](int i) {
+			board.unpack(positions[i]);
+			board.legal_moves(position_moves);
+		}, [&](int) {
+			for(Move move : position_moves) {
+				board.make_move(move);
+				checksum += board.hash_key;
+				board.unmake_move(move);
+			}
+			return (uint64_t)position_moves.size();
+		}}
+	};
+
+	std::cout << "positions " << count << ", repetitions " << repetitions << (counter.file < 0 ? ", cycle counter unavailable" : "") << "\n";
+	std::cout << std::left << std::setw(20) << "primitive" << std::right << std::setw(12) << "ns/call" << std::setw(10) << "p10" << std::setw(10) << "p90" << std::setw(14) << "cycles/call" << "\n";
+	std::cout << std::fixed << std::setprecision(2);
+	for(Primitive &primitive : primitives) {
+		time_pass(counter, count, primitive.setup, primitive.run, overhead);
+		std::vector<double> nanoseconds;
+		std::vector<double> cycles;
+		for(int r = 0; r < repetitions; r++) {
+			PassResult result = time_pass(counter, count, primitive.setup, primitive.run, overhead);
+			nanoseconds.push_back(result.nanoseconds / result.calls);
+			cycles.push_back(result.cycles / result.calls);
+		}
+		std::sort(nanoseconds.begin(), nanoseconds.end());
+		std::sort(cycles.begin(), cycles.end());
+		auto percentile = [&](std::vector<double> &values, int p) {
+			return values[(values.size() - 1) * p / 100];
+		};
+		std::cout << std::left << std::setw(20) << primitive.name << std::right << std::setw(12) << percentile(nanoseconds, 50) << std::setw(10) << percentile(nanoseconds, 10) << std::setw(10) << percentile(nanoseconds, 90);
+		if(counter.file >= 0) {
+			std::cout << std::setw(14) << percentile(cycles, 50);
+		} else {
+			std::cout << std::setw(14) << "-";
+		}
+		std::cout << std::endl;
+	}
+	std::cout << std::defaultfloat << "checksum " << (checksum & 0xffff) << "\n";
+	board.initialize_fen(start_position);
+}
@@ -0,0 +1,13 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <string>
+#include "board.h"
+
+// Time the attack and move generation primitives one at a time over a fixed corpus (one FEN per
+// line of path, otherwise positions from random games). Every primitive gets a warmup pass and
+// then repetitions timed passes. The median and 10th/90th percentile ns per call are printed, with
+// CPU cycles per call when perf_event_open is allowed.
+void micro_benchmark(Board &board, std::string path, int repetitions);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MOVE_H
 #define MOVE_H
 
+#include <cstdint>
+
 // Representation of difference special move cases
 enum move_flags {
     none,
@@ -45,10 +47,72 @@ public:
         return (move >> 24) & 0x7;
     }
 
+    // Empty move (a1a1), used as a placeholder in tables
+    Move () {
+        move = 0;
+    }
+
     // Constructor to encode move
     Move (int source, int target, int piece, int capture, int promote, int flag) {
         move = source | (target << 6) | (piece << 12) | (capture << 16) | (promote << 20) | (flag << 24);
     }
+
+    bool operator==(const Move &other) const {
+        return move == other.move;
+    }
+
+    bool operator!=(const Move &other) const {
+        return move != other.move;
+    }
+};
+
+// Compact 16 bit move for tables (transposition table, killers, PV and history).
+// The moving and captured pieces are recovered from the board's piece_list when unpacking.
+// Bits 0-5 source, 6-11 target, 12-15 code: a move flag (0-4) or a promotion (5-8 for N, B, R, Q)
+class PackedMove {
+public:
+    uint16_t move;
+
+    PackedMove () {
+        move = 0;
+    }
+
+    PackedMove (Move full) {
+        int code = full.promote() ? 4 + (full.promote() >> 1) : full.flag();
+        move = full.source() | (full.target() << 6) | (code << 12);
+    }
+
+    int source() const {
+        return move & 0x3f;
+    }
+
+    int target() const {
+        return (move >> 6) & 0x3f;
+    }
+
+    // Source and target only, for tables indexed by [from] [to]
+    int from_to() const {
+        return move & 0xfff;
+    }
+
+    // White promotion piece (WN, WB, WR, WQ) as stored in Move, or zero
+    int promote() const {
+        int code = move >> 12;
+        return code > double_push ? (code - 4) << 1 : 0;
+    }
+
+    int flag() const {
+        int code = move >> 12;
+        return code > double_push ? none : code;
+    }
+
+    bool operator==(const PackedMove &other) const {
+        return move == other.move;
+    }
+
+    bool operator!=(const PackedMove &other) const {
+        return move != other.move;
+    }
 };
 
 #endif
@@ -0,0 +1,96 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "packed_position.h"
+
+// Records per write
+const int position_buffer_size = 4096;
+
+PositionWriter::~PositionWriter() {
+	close();
+}
+
+bool PositionWriter::open(std::string path, bool append) {
+	close();
+	file = fopen(path.c_str(), append ? "ab" : "wb");
+	// Records are already batched, and unbuffered writes make fwrite's count what reached the file
+	if(file) {
+		setvbuf(file, nullptr, _IONBF, 0);
+	}
+	buffer.clear();
+	buffer.reserve(position_buffer_size);
+	written = 0;
+	return file != nullptr;
+}
+
+bool PositionWriter::close() {
+	if(!file) {
+		return true;
+	}
+	bool success = flush();
+	success = fclose(file) == 0 && success;
+	file = nullptr;
+	return success;
+}
+
+bool PositionWriter::write(const PackedPosition &position) {
+	buffer.push_back(position);
+	if(buffer.size() >= position_buffer_size) {
+		return flush();
+	}
+	return true;
+}
+
+bool PositionWriter::flush() {
+	if(buffer.empty()) {
+		return true;
+	}
+	// Only the records that reached the file count, so a short write is not reported as packed
+	uint64_t done = fwrite(buffer.data(), sizeof(PackedPosition), buffer.size(), file);
+	written += done;
+	bool success = done == buffer.size();
+	buffer.clear();
+	return success;
+}
+
+PositionReader::~PositionReader() {
+	close();
+}
+
+bool PositionReader::open(std::string path, bool sequential) {
+	close();
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0) {
+		return false;
+	}
+	struct stat status;
+	if(fstat(file, &status) < 0 || status.st_size % sizeof(PackedPosition)) {
+		::close(file);
+		return false;
+	}
+	if(status.st_size == 0) {
+		::close(file);
+		return true;
+	}
+
+	void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if(mapping == MAP_FAILED) {
+		return false;
+	}
+	madvise(mapping, status.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	data = (const PackedPosition *)mapping;
+	size = status.st_size / sizeof(PackedPosition);
+	position = 0;
+	return true;
+}
+
+void PositionReader::close() {
+	if(data) {
+		munmap((void *)data, size * sizeof(PackedPosition));
+	}
+	data = nullptr;
+	size = 0;
+	position = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef PACKED_POSITION_H
+#define PACKED_POSITION_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Fixed-size binary position for datasets, written with Board::pack and read back with Board::unpack.
+// The occupied squares are listed in ascending order by the occupancy bitboard, and pieces holds
+// their piece codes two per byte (low nibble first). Fields are stored in host (little-endian) order.
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t pieces [16];
+    uint8_t state;      // Castling rights in bits 0-3, side to move in bit 7
+    uint8_t en_passant; // 64 for none
+    uint8_t halfmove;   // Saturates at 255
+    uint8_t result;     // Game result from white's point of view (game_results), if known
+    uint16_t fullmove;
+    int16_t score;      // Evaluation from the side to move's point of view, if known
+};
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// Appends records to a file through a write buffer
+class PositionWriter {
+public:
+    ~PositionWriter();
+
+    FILE *file = nullptr;
+    std::vector<PackedPosition> buffer;
+    uint64_t written = 0; // Records that reached the file
+
+    // append keeps the records already in the file
+    bool open(std::string path, bool append = false);
+    bool close();
+    bool write(const PackedPosition &position);
+    bool flush();
+};
+
+// Read-only file of records memory-mapped from disk, for random access or a front to back pass
+class PositionReader {
+public:
+    ~PositionReader();
+
+    const PackedPosition *data = nullptr;
+    uint64_t size = 0;     // Records in the file
+    uint64_t position = 0; // Next record returned by next
+
+    // sequential tells the kernel the file is read in order (reads ahead, drops pages behind)
+    bool open(std::string path, bool sequential = true);
+    void close();
+
+    const PackedPosition &operator[](uint64_t index) const {
+        return data[index];
+    }
+    bool next(PackedPosition &record) {
+        if(position >= size) {
+            return false;
+        }
+        record = data[position++];
+        return true;
+    }
+};
+
+#endif
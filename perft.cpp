@@ -0,0 +1,260 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+#include "perft.h"
+#include "trace.h"
+#include "uci.h"
+
+uint64_t perft(Board &board, int depth) {
+    if(depth == 1) {
+        std::vector<Move> move_list = {};
+        board.legal_moves(move_list);
+        return move_list.size();
+    }
+
+    uint64_t nodes = 0;
+    std::vector<Move> move_list = {};
+    board.legal_moves(move_list);
+    for(int i = 0; i < move_list.size(); i++) {
+        board.make_move(move_list[i]);
+        nodes += perft(board, depth - 1);
+        board.unmake_move(move_list[i]);
+    }
+    return nodes;
+}
+
+void perft_split(Board &board, int depth) {
+    uint64_t total_nodes = 0;
+    uint64_t nodes;
+    std::vector<Move> move_list = {};
+    board.legal_moves(move_list);
+    std::cout<<"\n";
+    for(int i = 0; i < move_list.size(); i++) {
+        board.print_move(move_list[i]);
+        int64_t trace_begin = trace_start();
+        board.make_move(move_list[i]);
+        if(depth == 1) {
+          nodes = 1;
+        } else {
+          nodes = perft(board, depth - 1);
+        }
+
+        std::cout << nodes << "\n";
+        total_nodes += nodes;
+        board.unmake_move(move_list[i]);
+        trace_span("perft subtree", trace_begin, "move", PackedMove(move_list[i]).move);
+    }
+
+    std::cout << "total nodes: " << total_nodes << "\n";
+}
+
+// Journal lines appended by every process, read incrementally up to the last complete line
+struct PerftJournal {
+    std::string path;
+    uint64_t offset = 0;
+    std::map<std::string, uint64_t> counts; // "<fen>;<depth>"
+
+    void update() {
+        int file = open(path.c_str(), O_RDONLY);
+        if(file < 0) {
+            return;
+        }
+        std::string data;
+        char buffer [1 << 16];
+        ssize_t length;
+        lseek(file, offset, SEEK_SET);
+        while((length = read(file, buffer, sizeof(buffer))) > 0) {
+            data.append(buffer, length);
+        }
+        close(file);
+        size_t start = 0;
+        size_t end;
+        while((end = data.find('\n', start)) != std::string::npos) {
+            std::string line = data.substr(start, end - start);
+            size_t separator = line.rfind(';');
+            if(separator != std::string::npos && separator + 1 < line.size()) {
+                counts[line.substr(0, separator)] = std::stoull(line.substr(separator + 1));
+            }
+            start = end + 1;
+        }
+        offset += start;
+    }
+
+    bool append(const std::string &line) {
+        int file = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if(file < 0) {
+            return false;
+        }
+        // A single write of a whole line, so lines of concurrent processes never interleave
+        bool written = write(file, line.data(), line.size()) == (ssize_t)line.size() && fdatasync(file) == 0;
+        return close(file) == 0 && written;
+    }
+};
+
+struct PerftUnit {
+    std::string fen;
+    uint64_t multiplicity; // Paths from the root that reach the position
+};
+
+// Distinct positions plies below the root in move generation order. The move counters are
+// dropped so transpositions share a unit.
+void collect_units(Board &board, int plies, std::map<std::string, size_t> &positions, std::vector<PerftUnit> &units) {
+    if(plies == 0) {
+        char fen [max_fen_length];
+        std::string position (fen, board.to_fen(fen));
+        position = position.substr(0, position.rfind(' ', position.rfind(' ') - 1)) + " 0 1";
+        auto found = positions.find(position);
+        if(found != positions.end()) {
+            units[found->second].multiplicity++;
+        } else {
+            positions[position] = units.size();
+            units.push_back({position, 1});
+        }
+        return;
+    }
+    std::vector<Move> move_list = {};
+    board.legal_moves(move_list);
+    for(Move move : move_list) {
+        board.make_move(move);
+        collect_units(board, plies - 1, positions, units);
+        board.unmake_move(move);
+    }
+}
+
+// The job file is created once, through a link so a concurrent start never reads it half written
+bool open_job(DeepPerftSettings &settings) {
+    std::string path = settings.directory + "/job";
+    std::ifstream job(path);
+    if(!job) {
+        if(settings.depth <= 0) {
+            std::cout << "no job in " << settings.directory << ", give a depth to start one\n";
+            return false;
+        }
+        if(settings.fen.empty()) {
+            settings.fen = start_position;
+        }
+        std::string line = settings.fen + ";" + std::to_string(settings.depth) + ";" + std::to_string(settings.split) + "\n";
+        std::string temporary = path + "." + std::to_string(getpid());
+        int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool written = file >= 0 && write(file, line.data(), line.size()) == (ssize_t)line.size();
+        written = file >= 0 && close(file) == 0 && written;
+        bool linked = written && link(temporary.c_str(), path.c_str()) == 0;
+        unlink(temporary.c_str());
+        if(linked) {
+            return true;
+        }
+        if(!written) {
+            std::cout << "could not write " << path << "\n";
+            return false;
+        }
+        job.open(path);
+    }
+    std::string line;
+    std::getline(job, line);
+    size_t second = line.rfind(';');
+    size_t first = second == std::string::npos || second == 0 ? std::string::npos : line.rfind(';', second - 1);
+    if(first == std::string::npos) {
+        std::cout << "invalid job " << path << "\n";
+        return false;
+    }
+    std::string fen = line.substr(0, first);
+    int depth = std::stoi(line.substr(first + 1));
+    int split = std::stoi(line.substr(second + 1));
+    if((!settings.fen.empty() && settings.fen != fen) || (settings.depth > 0 && (settings.depth != depth || settings.split != split))) {
+        std::cout << "a different job is in " << settings.directory << ": " << line << "\n";
+        return false;
+    }
+    settings.fen = fen;
+    settings.depth = depth;
+    settings.split = split;
+    return true;
+}
+
+bool deep_perft(Board &board, DeepPerftSettings &settings) {
+    mkdir(settings.directory.c_str(), 0755);
+    if(!open_job(settings)) {
+        return false;
+    }
+    if(settings.split < 0 || settings.split >= settings.depth || !board.initialize_fen(settings.fen)) {
+        std::cout << "invalid job: depth " << settings.depth << ", split " << settings.split << ", fen " << settings.fen << "\n";
+        return false;
+    }
+    std::map<std::string, size_t> positions;
+    std::vector<PerftUnit> units;
+    collect_units(board, settings.split, positions, units);
+    int unit_depth = settings.depth - settings.split;
+    std::string suffix = ";" + std::to_string(unit_depth);
+    std::cout << "perft " << settings.depth << " of " << settings.fen << ": " << units.size() << " units of depth " << unit_depth << std::endl;
+
+    PerftJournal journal;
+    journal.path = settings.directory + "/journal";
+    int claims = open((settings.directory + "/claims").c_str(), O_RDWR | O_CREAT, 0644);
+    if(claims < 0) {
+        std::cout << "could not open " << settings.directory << "/claims\n";
+        return false;
+    }
+    auto lock = [&](size_t unit, short type) {
+        struct flock region = {};
+        region.l_type = type;
+        region.l_whence = SEEK_SET;
+        region.l_start = unit;
+        region.l_len = 1;
+        return fcntl(claims, F_SETLK, &region) == 0;
+    };
+
+    // Passes over the units left until the journal has them all, waiting while others hold the rest
+    bool failed = false;
+    while(!failed) {
+        journal.update();
+        size_t left = 0;
+        size_t claimed = 0;
+        for(size_t i = 0; i < units.size() && !failed; i++) {
+            if(journal.counts.count(units[i].fen + suffix)) {
+                continue;
+            }
+            left++;
+            if(!lock(i, F_WRLCK)) {
+                continue;
+            }
+            // Another process may have finished it since the last read
+            journal.update();
+            if(!journal.counts.count(units[i].fen + suffix)) {
+                claimed++;
+                int64_t trace_begin = trace_start();
+                auto start = std::chrono::steady_clock::now();
+                board.initialize_fen(units[i].fen);
+                uint64_t nodes = perft(board, unit_depth);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                trace_span("perft unit", trace_begin, "unit", i);
+                failed = !journal.append(units[i].fen + suffix + ";" + std::to_string(nodes) + "\n");
+                journal.counts[units[i].fen + suffix] = nodes;
+                std::cout << "unit " << i + 1 << "/" << units.size() << " " << nodes << " nodes " << seconds << " s " << units[i].fen << std::endl;
+            }
+            lock(i, F_UNLCK);
+        }
+        if(left == 0) {
+            break;
+        }
+        if(claimed == 0) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+    close(claims);
+    if(failed) {
+        std::cout << "could not append to " << journal.path << "\n";
+        return false;
+    }
+
+    uint64_t total_nodes = 0;
+    for(PerftUnit &unit : units) {
+        total_nodes += unit.multiplicity * journal.counts[unit.fen + suffix];
+    }
+    std::cout << "total nodes: " << total_nodes << "\n";
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint>
+#include <string>
+#include "board.h"
+
+// Count leaf nodes of the legal move tree
+uint64_t perft(Board &board, int depth);
+
+// Print the node count below every root move
+void perft_split(Board &board, int depth);
+
+// A deep perft is split into work units, the distinct positions split plies below the root, each
+// counted to depth - split. The job directory holds the job (root FEN, depth, split) and a journal
+// with a line "<fen>;<depth>;<count>" per finished unit, synced after each append. Running again
+// skips the units in the journal, so an interrupted job loses at most the units in progress. Any
+// number of processes can work on the same directory: a unit is claimed with a lock on its byte
+// of the claims file, which the system drops when a process dies.
+struct DeepPerftSettings {
+    std::string directory;
+    std::string fen;   // Root position of a new job
+    int depth = 0;     // Taken from the job when 0
+    int split = 2;
+};
+
+bool deep_perft(Board &board, DeepPerftSettings &settings);
+
+#endif
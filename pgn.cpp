@@ -0,0 +1,263 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include "pgn.h"
+#include "uci.h"
+
+// Piece letters of standard algebraic notation, as white piece codes
+int san_piece(char letter) {
+	switch(letter) {
+		case 'N':
+			return WN;
+		case 'B':
+			return WB;
+		case 'R':
+			return WR;
+		case 'Q':
+			return WQ;
+		case 'K':
+			return WK;
+		default:
+			return WP;
+	}
+}
+
+Move parse_san(Board &board, const char *san, int length) {
+	// Castling (also written with zeros)
+	if(san[0] == 'O' || san[0] == '0') {
+		int side = board.side;
+		bool queen_side = length >= 5 && san[3] == '-';
+		if(!(board.castling_rights.back() & ((queen_side ? 4 : 1) << side)) || (Board::castling_occupancy_mask[side][queen_side] & board.occupancies[BOTH])) {
+			return Move();
+		}
+		Move move (Board::castling_locations[side][0], Board::castling_locations[side][queen_side ? 4 : 3], WK + side, E, 0, queen_side ? q_castling : k_castling);
+		return board.is_legal(move) ? move : Move();
+	}
+
+	// Piece, up to two disambiguation characters, target square, promotion
+	int piece = WP;
+	int i = 0;
+	if(san[0] == 'N' || san[0] == 'B' || san[0] == 'R' || san[0] == 'Q' || san[0] == 'K') {
+		piece = san_piece(san[0]);
+		i++;
+	}
+	char squares [4];
+	int count = 0;
+	int promote = 0;
+	for(; i < length; i++) {
+		char c = san[i];
+		if((c >= 'a' && c <= 'h') || (c >= '1' && c <= '8')) {
+			if(count == 4) {
+				return Move();
+			}
+			squares[count++] = c;
+		} else if(c == 'N' || c == 'B' || c == 'R' || c == 'Q') {
+			promote = san_piece(c);
+		}
+	}
+	if(count < 2 || squares[count - 2] < 'a' || squares[count - 1] > '8') {
+		return Move();
+	}
+	int target = (squares[count - 2] - 'a') + 8 * (squares[count - 1] - '1');
+	int from_file = -1;
+	int from_rank = -1;
+	for(int j = 0; j + 2 < count; j++) {
+		if(squares[j] >= 'a') {
+			from_file = squares[j] - 'a';
+		} else {
+			from_rank = squares[j] - '1';
+		}
+	}
+	return board.resolve_move(piece, target, from_file, from_rank, promote);
+}
+
+PgnReader::~PgnReader() {
+	close();
+}
+
+bool PgnReader::open(std::string path) {
+	close();
+	games = 0;
+	errors = 0;
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0) {
+		return false;
+	}
+	struct stat status;
+	if(fstat(file, &status) < 0) {
+		::close(file);
+		return false;
+	}
+	if(status.st_size == 0) {
+		::close(file);
+		return true;
+	}
+
+	void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if(mapping == MAP_FAILED) {
+		return false;
+	}
+	// The file is read once from front to back
+	madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+	data = (const char *)mapping;
+	size = status.st_size;
+	position = 0;
+	return true;
+}
+
+void PgnReader::close() {
+	if(data) {
+		munmap((void *)data, size);
+	}
+	data = nullptr;
+	size = 0;
+	position = 0;
+}
+
+void PgnReader::skip_line() {
+	const char *end = (const char *)memchr(data + position, '\n', size - position);
+	position = end ? end - data + 1 : size;
+}
+
+// Read the tag pairs of the next game, keeping only Result and FEN. False when no game is left.
+// valid is cleared when the FEN tag cannot be read.
+bool PgnReader::read_tags(Board &board, bool &valid) {
+	result = UNKNOWN_RESULT;
+	valid = true;
+	bool in_tags = false;
+	bool has_fen = false;
+	while(position < size) {
+		char c = data[position];
+		if(c == '[') {
+			in_tags = true;
+			const char *tag = data + position + 1;
+			uint64_t remaining = size - position - 1;
+			if(remaining > 10 && !memcmp(tag, "Result \"", 8)) {
+				if(tag[8] == '1' && tag[9] == '-') {
+					result = WHITE_WIN;
+				} else if(tag[8] == '0' && tag[9] == '-') {
+					result = BLACK_WIN;
+				} else if(tag[8] == '1' && tag[9] == '/') {
+					result = DRAW;
+				}
+			} else if(remaining > 5 && !memcmp(tag, "FEN \"", 5)) {
+				const char *end = (const char *)memchr(tag + 5, '"', remaining - 5);
+				char fen [max_fen_length];
+				int length = end ? end - tag - 5 : 0;
+				has_fen = true;
+				if(length > 0 && length < max_fen_length) {
+					memcpy(fen, tag + 5, length);
+					fen[length] = 0;
+					valid = board.initialize_fen(fen);
+				} else {
+					valid = false;
+				}
+			}
+			skip_line();
+		} else if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+			position++;
+		} else if(in_tags) {
+			break;
+		} else {
+			// Stray text before the first tag
+			skip_line();
+		}
+	}
+	if(!in_tags) {
+		return false;
+	}
+	if(!has_fen) {
+		board.initialize_fen(start_position);
+	}
+	return true;
+}
+
+bool PgnReader::next_game(Board &board, const std::function<bool(Board &, Move)> &visit) {
+	bool replaying;
+	if(!read_tags(board, replaying)) {
+		return false;
+	}
+	games++;
+	if(!replaying) {
+		errors++;
+	}
+
+	// Movetext until the termination marker, skipping comments, variations and annotations
+	int variation_depth = 0;
+	while(position < size) {
+		char c = data[position];
+		switch(c) {
+			case ' ':
+			case '\t':
+			case '\r':
+			case '\n':
+			case '.':
+				position++;
+				break;
+			case '{': {
+				const char *end = (const char *)memchr(data + position, '}', size - position);
+				position = end ? end - data + 1 : size;
+				break;
+			}
+			case ';':
+				skip_line();
+				break;
+			case '(':
+				variation_depth++;
+				position++;
+				break;
+			case ')':
+				variation_depth--;
+				position++;
+				break;
+			case '*':
+				position++;
+				return true;
+			case '[':
+				// The next game starts without a termination marker
+				if(data[position - 1] == '\n') {
+					return true;
+				}
+				position++;
+				break;
+			default: {
+				uint64_t start = position;
+				while(position < size) {
+					char t = data[position];
+					if(t == ' ' || t == '\n' || t == '\r' || t == '\t' || t == '.' || t == '{' || t == '(' || t == ')' || t == ';') {
+						break;
+					}
+					position++;
+				}
+				const char *token = data + start;
+				int length = position - start;
+
+				// Results end the game and move numbers are skipped, but 0-0 is castling
+				if(token[0] >= '0' && token[0] <= '9' && !(length >= 3 && token[0] == '0' && token[1] == '-' && token[2] == '0')) {
+					if(length >= 3 && (token[1] == '-' || token[1] == '/')) {
+						return true;
+					}
+					break;
+				}
+				if(variation_depth > 0 || !replaying || token[0] == '$') {
+					break;
+				}
+
+				Move move = parse_san(board, token, length);
+				if(move == Move()) {
+					errors++;
+					replaying = false;
+				} else if(!visit(board, move)) {
+					replaying = false;
+				} else {
+					board.make_move(move);
+				}
+				break;
+			}
+		}
+	}
+	return true;
+}
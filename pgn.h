@@ -0,0 +1,43 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "board.h"
+
+// Game results as written in the Result tag
+enum game_results {BLACK_WIN, DRAW, WHITE_WIN, UNKNOWN_RESULT};
+
+// Find the move written in standard algebraic notation (not null terminated), or an empty move.
+// Only the pieces that could reach the target square are looked at, the move list is never generated.
+Move parse_san(Board &board, const char *san, int length);
+
+// Streams games from a memory-mapped PGN file and replays them on a board.
+// Tokens are read in place from the mapping, so no memory is allocated per token or per game.
+class PgnReader {
+public:
+    ~PgnReader();
+
+    const char *data = nullptr;
+    uint64_t size = 0;
+    uint64_t position = 0;
+
+    int result;      // Result tag of the current game
+    uint64_t games;  // Games read so far
+    uint64_t errors; // Games abandoned on an unreadable move
+
+    bool open(std::string path);
+    void close();
+
+    // Replay the next game from its starting position (the FEN tag or the standard position).
+    // visit is called for every position before its move is made and may return false to skip
+    // the rest of the game. Returns false at the end of the file.
+    bool next_game(Board &board, const std::function<bool(Board &, Move)> &visit);
+
+    // Tokenizer helpers
+    void skip_line();
+    bool read_tags(Board &board, bool &valid);
+};
+
+#endif
@@ -0,0 +1,680 @@
+#include <cstdio>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include "search.h"
+#include "evaluate.h"
+#include "bits.h"
+#include "stats.h"
+#include "trace.h"
+
+// Margins for the shallow depth pruning techniques
+const int reverse_futility_margin = 80;
+const int futility_margin [4] = {0, 120, 240, 360};
+
+// How far below the last MultiPV line of the previous iteration root moves are still searched exactly
+const int multi_pv_margin = 50;
+
+Search::Search() {
+	stop = false;
+	pondering = false;
+	tt = nullptr;
+	// Logarithmic late move reductions
+	for(int depth = 0; depth < 64; depth++) {
+		for(int moves = 0; moves < 64; moves++) {
+			reductions[depth][moves] = (depth && moves) ? (int)(0.75 + log(depth) * log(moves) / 2.25) : 0;
+		}
+	}
+	clear();
+	reset_tree_statistics();
+}
+
+// Forget move ordering information between games
+void Search::clear() {
+	for(int i = 0; i < MAX_PLY; i++) {
+		killers[i][0] = PackedMove();
+		killers[i][1] = PackedMove();
+	}
+	for(int i = 0; i < 4096; i++) {
+		history[i] = 0;
+	}
+	for(auto &helper : helpers) {
+		helper->clear();
+	}
+}
+
+void Search::set_threads(int threads) {
+	helpers.clear();
+	for(int i = 1; i < threads; i++) {
+		helpers.emplace_back(new Search());
+		helpers.back()->start_depth = 1 + i % 2;
+	}
+}
+
+void Search::reset_tree_statistics() {
+	for(int i = 0; i < MAX_PLY; i++) {
+		depth_counters[i] = TreeCounters();
+		ply_counters[i] = TreeCounters();
+		iteration_nodes[i] = 0;
+	}
+	for(auto &helper : helpers) {
+		helper->reset_tree_statistics();
+	}
+}
+
+// One table by remaining depth and one by ply, summed over the helpers, then the effective branching
+// factor of the main search's iterations
+void Search::print_tree_statistics(const char *prefix) {
+	if(!statistics_enabled) {
+		return;
+	}
+	TreeCounters by_depth [MAX_PLY];
+	TreeCounters by_ply [MAX_PLY];
+	for(int i = 0; i < MAX_PLY; i++) {
+		by_depth[i] = depth_counters[i];
+		by_ply[i] = ply_counters[i];
+		for(auto &helper : helpers) {
+			TreeCounters *counters [2] = {&by_depth[i], &by_ply[i]};
+			TreeCounters *helper_counters [2] = {&helper->depth_counters[i], &helper->ply_counters[i]};
+			for(int j = 0; j < 2; j++) {
+				counters[j]->nodes += helper_counters[j]->nodes;
+				counters[j]->tt_cutoffs += helper_counters[j]->tt_cutoffs;
+				counters[j]->fail_highs += helper_counters[j]->fail_highs;
+				counters[j]->first_move_cutoffs += helper_counters[j]->first_move_cutoffs;
+				counters[j]->cutoff_index_sum += helper_counters[j]->cutoff_index_sum;
+				counters[j]->lmr_researches += helper_counters[j]->lmr_researches;
+				counters[j]->pvs_researches += helper_counters[j]->pvs_researches;
+			}
+		}
+	}
+
+	auto percent = [](uint64_t a, uint64_t b) {
+		return b ? 100.0 * a / b : 0.0;
+	};
+	auto print_table = [&](const char *label, TreeCounters *rows) {
+		printf("%s%6s %12s %8s %8s %8s %8s %10s %10s\n", prefix, label, "nodes", "tt_cut%", "fh%", "first%", "cut_idx", "lmr_re", "pvs_re");
+		for(int i = 0; i < MAX_PLY; i++) {
+			TreeCounters &row = rows[i];
+			if(!row.nodes) {
+				continue;
+			}
+			printf("%s%6d %12llu %8.2f %8.2f %8.2f %8.2f %10llu %10llu\n", prefix, i, (unsigned long long)row.nodes, percent(row.tt_cutoffs, row.nodes), percent(row.fail_highs, row.nodes),
+				percent(row.first_move_cutoffs, row.fail_highs), row.fail_highs ? (double)row.cutoff_index_sum / row.fail_highs : 0.0, (unsigned long long)row.lmr_researches, (unsigned long long)row.pvs_researches);
+		}
+	};
+	print_table("depth", by_depth);
+	print_table("ply", by_ply);
+
+	printf("%s%6s %12s %8s\n", prefix, "iter", "nodes", "ebf");
+	for(int i = 1; i < MAX_PLY; i++) {
+		if(iteration_nodes[i]) {
+			printf("%s%6d %12llu %8.2f\n", prefix, i, (unsigned long long)iteration_nodes[i], iteration_nodes[i - 1] ? (double)iteration_nodes[i] / iteration_nodes[i - 1] : 0.0);
+		}
+	}
+	fflush(stdout);
+}
+
+// Nodes of this search and its helpers (approximate while they run)
+uint64_t Search::total_nodes() {
+	uint64_t total = nodes;
+	for(auto &helper : helpers) {
+		total += helper->nodes;
+	}
+	return total;
+}
+
+int64_t Search::elapsed() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// Split the remaining clock time into a soft limit (no new iteration) and a hard limit (abort)
+void Search::allocate_time() {
+	soft_limit = 0;
+	hard_limit = 0;
+	if(limits.infinite) {
+		return;
+	}
+	if(limits.movetime) {
+		soft_limit = limits.movetime;
+		hard_limit = limits.movetime;
+	} else if(limits.time[board.side]) {
+		int64_t remaining = limits.time[board.side];
+		int moves_left = limits.movestogo ? limits.movestogo : 30;
+		int64_t allocation = remaining / moves_left + limits.increment[board.side] * 3 / 4;
+		int64_t maximum = remaining - 50 > 1 ? remaining - 50 : 1;
+		soft_limit = allocation < maximum ? allocation : maximum;
+		hard_limit = allocation * 4 < maximum ? allocation * 4 : maximum;
+	}
+}
+
+// Stop once the hard time limit or node limit is reached, but always finish the first iteration
+void Search::check_limits() {
+	if(completed_depth < 1 || pondering) {
+		return;
+	}
+	if(limits.ponder && ponderhit_time < 0) {
+		ponderhit_time = elapsed();
+		// Pondering already took the time this move was given
+		if(soft_limit && ponderhit_time >= soft_limit) {
+			stop = true;
+			return;
+		}
+	}
+	int64_t clock = elapsed() - std::max<int64_t>(ponderhit_time, 0);
+	if((hard_limit && clock >= hard_limit) || (limits.nodes && nodes >= limits.nodes)) {
+		stop = true;
+	}
+}
+
+bool Search::has_non_pawn_material() {
+	return (board.bitboards[WN + board.side] | board.bitboards[WB + board.side] | board.bitboards[WR + board.side] | board.bitboards[WQ + board.side]) != 0;
+}
+
+// Mate scores are stored relative to the node instead of the root
+int score_to_tt(int score, int ply) {
+	if(score > MATE_SCORE - MAX_PLY) {
+		return score + ply;
+	}
+	if(score < -MATE_SCORE + MAX_PLY) {
+		return score - ply;
+	}
+	return score;
+}
+
+int score_from_tt(int score, int ply) {
+	if(score > MATE_SCORE - MAX_PLY) {
+		return score - ply;
+	}
+	if(score < -MATE_SCORE + MAX_PLY) {
+		return score + ply;
+	}
+	return score;
+}
+
+// Order by hash move, captures (most valuable victim, least valuable attacker), killers then history
+void Search::score_moves(std::vector<Move> &move_list, PackedMove tt_move) {
+	int *scores = move_scores[ply];
+	for(int i = 0; i < move_list.size(); i++) {
+		Move move = move_list[i];
+		PackedMove packed = PackedMove(move);
+		if(packed == tt_move) {
+			scores[i] = 1000000;
+		} else if(move.capture() != E) {
+			scores[i] = 100000 + (move.capture() >> 1) * 10 - (move.piece() >> 1);
+		} else if(move.promote()) {
+			scores[i] = 100000 + move.promote();
+		} else if(packed == killers[ply][0]) {
+			scores[i] = 90000;
+		} else if(packed == killers[ply][1]) {
+			scores[i] = 80000;
+		} else {
+			scores[i] = history[packed.from_to()];
+		}
+	}
+}
+
+// Selection sort one step, so the remaining moves are only ordered if they are reached
+Move Search::pick_move(std::vector<Move> &move_list, int index) {
+	int *scores = move_scores[ply];
+	int best = index;
+	for(int i = index + 1; i < move_list.size(); i++) {
+		if(scores[i] > scores[best]) {
+			best = i;
+		}
+	}
+	std::swap(move_list[index], move_list[best]);
+	std::swap(scores[index], scores[best]);
+	return move_list[index];
+}
+
+int Search::quiescence(int alpha, int beta) {
+	pv_length[ply] = ply;
+	if((nodes & 2047) == 0) {
+		check_limits();
+	}
+	if(stop) {
+		return 0;
+	}
+	nodes++;
+	count(STAT_QSEARCH_NODES);
+	count_tree(0, &TreeCounters::nodes);
+
+	if(ply >= MAX_PLY - 1) {
+		return evaluate(board, material_table);
+	}
+
+	// In check every evasion is searched (so they are generated legal in either mode), otherwise the
+	// side to move may stand pat
+	bool in_check = board.in_check();
+	std::vector<Move> &move_list = move_lists[ply];
+	int best_score;
+	if(in_check) {
+		board.legal_moves(move_list);
+		if(move_list.empty()) {
+			return -MATE_SCORE + ply;
+		}
+		best_score = -INF_SCORE;
+	} else {
+		best_score = evaluate(board, material_table);
+		if(best_score >= beta) {
+			return best_score;
+		}
+		if(best_score > alpha) {
+			alpha = best_score;
+		}
+		if(options.pseudo_legal) {
+			board.pseudo_legal_captures(move_list);
+		} else {
+			board.legal_captures(move_list);
+		}
+	}
+
+	score_moves(move_list, PackedMove());
+	for(int i = 0; i < move_list.size(); i++) {
+		Move move = pick_move(move_list, i);
+		if(options.pseudo_legal && !in_check && !board.is_legal(move)) {
+			continue;
+		}
+		board.make_move(move);
+		ply++;
+		int score = -quiescence(-beta, -alpha);
+		ply--;
+		board.unmake_move(move);
+		if(stop) {
+			return 0;
+		}
+
+		if(score > best_score) {
+			best_score = score;
+			if(score > alpha) {
+				alpha = score;
+				if(score >= beta) {
+					break;
+				}
+			}
+		}
+	}
+	return best_score;
+}
+
+int Search::negamax(int alpha, int beta, int depth, bool null_allowed) {
+	bool pv_node = beta - alpha > 1;
+	pv_length[ply] = ply;
+	if(depth <= 0) {
+		return quiescence(alpha, beta);
+	}
+	if((nodes & 2047) == 0) {
+		check_limits();
+	}
+	if(stop) {
+		return 0;
+	}
+	nodes++;
+	count(STAT_NODES);
+	count_tree(depth, &TreeCounters::nodes);
+
+	if(ply > 0 && board.is_draw()) {
+		return 0;
+	}
+
+	// Endgames in the tablebases are known exactly
+	if(ply > 0 && tablebases && pop_count(board.occupancies[BOTH]) <= tablebases->max_pieces) {
+		int result, distance;
+		if(tablebases->probe(board, result, distance)) {
+			tb_hits++;
+			if(result == 0) {
+				return 0;
+			}
+			// Mates too deep to be told apart from the search's mate scores are scored just below them
+			int score = ply + distance < MAX_PLY ? MATE_SCORE - ply - distance : MATE_SCORE - MAX_PLY - 1;
+			return result > 0 ? score : -score;
+		}
+	}
+
+	if(ply >= MAX_PLY - 1) {
+		return evaluate(board, material_table);
+	}
+
+	// Transposition table cutoffs (not at the root, which must return a move)
+	TTEntry entry;
+	PackedMove tt_move;
+	if(tt->probe(board.hash_key, entry)) {
+		tt_move = entry.move;
+		if(!pv_node && ply > 0 && entry.depth >= depth) {
+			int score = score_from_tt(entry.score, ply);
+			if(entry.flag == TT_EXACT || (entry.flag == TT_LOWER && score >= beta) || (entry.flag == TT_UPPER && score <= alpha)) {
+				count_tree(depth, &TreeCounters::tt_cutoffs);
+				return score;
+			}
+		}
+	}
+
+	// Check extension
+	bool in_check = board.in_check();
+	if(in_check) {
+		depth++;
+	}
+	int static_eval = in_check ? -INF_SCORE : evaluate(board, material_table);
+
+	if(!pv_node && !in_check) {
+		// Reverse futility pruning: the static evaluation is so far above beta that a shallow search will not fall below it
+		if(options.reverse_futility_pruning && depth <= 6 && abs(beta) < MATE_SCORE - MAX_PLY && static_eval - reverse_futility_margin * depth >= beta) {
+			return static_eval;
+		}
+
+		// Adaptive null move pruning: reduce more at higher depths and further above beta
+		if(options.null_move_pruning && null_allowed && depth >= 3 && static_eval >= beta && has_non_pawn_material()) {
+			int reduction = 3 + depth / 4 + std::min((static_eval - beta) / 200, 3);
+			board.make_null_move();
+			ply++;
+			int score = -negamax(-beta, -beta + 1, depth - 1 - reduction, false);
+			ply--;
+			board.unmake_null_move();
+			if(stop) {
+				return 0;
+			}
+			if(score >= beta) {
+				// Do not trust unproven mates from a null move search
+				return score >= MATE_SCORE - MAX_PLY ? beta : score;
+			}
+		}
+	}
+
+	std::vector<Move> &move_list = move_lists[ply];
+	if(options.pseudo_legal) {
+		board.pseudo_legal_moves(move_list);
+	} else {
+		board.legal_moves(move_list);
+	}
+	score_moves(move_list, tt_move);
+	// The lines of the last iteration are tried first, in their order
+	bool multi_root = ply == 0 && multi_pv > 1;
+	if(multi_root) {
+		root_lines.clear();
+		for(int i = 0; i < move_list.size(); i++) {
+			for(int line = 0; line < lines.size(); line++) {
+				if(PackedMove(move_list[i]) == lines[line].pv[0]) {
+					move_scores[0][i] = 1000000 - line;
+				}
+			}
+		}
+	}
+
+	// Futility pruning: quiet moves cannot raise a static evaluation this far below alpha at low depth
+	bool futile = options.futility_pruning && !pv_node && !in_check && depth <= 3 && abs(alpha) < MATE_SCORE - MAX_PLY && static_eval + futility_margin[depth] <= alpha;
+	int late_move_count = 3 + depth * depth;
+
+	int best_score = -INF_SCORE;
+	PackedMove best_move;
+	int flag = TT_UPPER;
+	int moves_searched = 0;
+	int quiets_searched = 0;
+	for(int i = 0; i < move_list.size(); i++) {
+		Move move = pick_move(move_list, i);
+		bool quiet = move.capture() == E && !move.promote();
+
+		// Late move pruning: skip the remaining quiet moves once enough have been tried at low depth
+		if(options.late_move_pruning && quiet && !pv_node && !in_check && depth <= 4 && quiets_searched >= late_move_count && best_score > -MATE_SCORE + MAX_PLY) {
+			continue;
+		}
+		if(options.pseudo_legal && !board.is_legal(move)) {
+			continue;
+		}
+
+		board.make_move(move);
+		bool gives_check = board.in_check();
+		if(futile && quiet && !gives_check && moves_searched > 0) {
+			board.unmake_move(move);
+			continue;
+		}
+		ply++;
+
+		// Principal variation search, with late quiet moves searched at reduced depth first. At a
+		// MultiPV root the lower end of the window is the last line kept, or the floor until there
+		// are enough lines, so every line gets an exact score.
+		int line_alpha = alpha;
+		if(multi_root) {
+			line_alpha = root_lines.size() < multi_pv ? line_floor : std::max(line_floor, root_lines.back().score);
+		}
+		int score;
+		if(moves_searched == 0 || (multi_root && line_alpha == -INF_SCORE)) {
+			score = -negamax(-beta, -line_alpha, depth - 1, true);
+		} else {
+			int reduction = 0;
+			if(options.late_move_reductions && depth >= 3 && moves_searched >= 2 && quiet && !in_check && !gives_check) {
+				reduction = reductions[std::min(depth, 63)][std::min(moves_searched, 63)];
+				if(pv_node) {
+					reduction--;
+				}
+				if(PackedMove(move) == killers[ply - 1][0] || PackedMove(move) == killers[ply - 1][1]) {
+					reduction--;
+				}
+				reduction = std::max(0, std::min(reduction, depth - 2));
+			}
+
+			score = -negamax(-line_alpha - 1, -line_alpha, depth - 1 - reduction, true);
+			if(score > line_alpha && reduction > 0) {
+				count_tree(depth - 1, &TreeCounters::lmr_researches);
+				score = -negamax(-line_alpha - 1, -line_alpha, depth - 1, true);
+			}
+			if(score > line_alpha && score < beta) {
+				count_tree(depth - 1, &TreeCounters::pvs_researches);
+				score = -negamax(-beta, -line_alpha, depth - 1, true);
+			}
+		}
+		ply--;
+		board.unmake_move(move);
+		if(stop) {
+			return 0;
+		}
+		moves_searched++;
+		if(quiet) {
+			quiets_searched++;
+		}
+
+		// Only completely searched moves become lines, so a stopped search keeps none half done
+		if(multi_root && score > line_alpha) {
+			RootLine line = {score, {PackedMove(move)}};
+			line.pv.insert(line.pv.end(), pv_table[1] + 1, pv_table[1] + pv_length[1]);
+			auto later = std::find_if(root_lines.begin(), root_lines.end(), [&](const RootLine &other) {
+				return other.score < score;
+			});
+			root_lines.insert(later, line);
+			if(root_lines.size() > multi_pv) {
+				root_lines.pop_back();
+			}
+		}
+
+		if(score > best_score) {
+			best_score = score;
+			best_move = PackedMove(move);
+			if(score > alpha) {
+				alpha = score;
+				flag = TT_EXACT;
+
+				// Update the principal variation
+				if(ply == 0 && best_move != pv_table[0][0]) {
+					trace_instant("root move", "move", best_move.move);
+				}
+				pv_table[ply][ply] = best_move;
+				for(int next = ply + 1; next < pv_length[ply + 1]; next++) {
+					pv_table[ply][next] = pv_table[ply + 1][next];
+				}
+				pv_length[ply] = pv_length[ply + 1];
+
+				if(score >= beta) {
+					flag = TT_LOWER;
+					count(STAT_CUTOFFS);
+					count(STAT_CUTOFF_MOVE_1 + std::min(moves_searched - 1, 7));
+					count_tree(depth, &TreeCounters::fail_highs);
+					count_tree(depth, &TreeCounters::first_move_cutoffs, moves_searched == 1);
+					count_tree(depth, &TreeCounters::cutoff_index_sum, moves_searched - 1);
+					if(quiet) {
+						if(best_move != killers[ply][0]) {
+							killers[ply][1] = killers[ply][0];
+							killers[ply][0] = best_move;
+						}
+						history[best_move.from_to()] += depth * depth;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	// Checkmate or stalemate (moves are only pruned once one has been searched)
+	if(moves_searched == 0) {
+		return in_check ? -MATE_SCORE + ply : 0;
+	}
+
+	// A fail low has no real best move, so the stored hash move is kept
+	tt->store(board.hash_key, flag == TT_UPPER ? PackedMove() : best_move, score_to_tt(best_score, ply), depth, flag);
+	return best_score;
+}
+
+void Search::print_info(int depth, int score, int line, const std::vector<PackedMove> &pv) {
+	int64_t time = elapsed();
+	std::cout << "info depth " << depth;
+	if(multi_pv > 1) {
+		std::cout << " multipv " << line + 1;
+	}
+	std::cout << " score ";
+	if(abs(score) > MATE_SCORE - MAX_PLY) {
+		int mate_in = (MATE_SCORE - abs(score) + 1) / 2;
+		std::cout << "mate " << (score > 0 ? mate_in : -mate_in);
+	} else {
+		std::cout << "cp " << score;
+	}
+	uint64_t searched = total_nodes();
+	std::cout << " nodes " << searched << " nps " << searched * 1000 / (time ? time : 1) << " time " << time;
+	if(tablebases) {
+		uint64_t hits = tb_hits;
+		for(auto &helper : helpers) {
+			hits += helper->tb_hits;
+		}
+		std::cout << " tbhits " << hits;
+	}
+	std::cout << " pv";
+	for(PackedMove move : pv) {
+		std::cout << " " << board.move_to_uci(move);
+	}
+	std::cout << std::endl;
+}
+
+// Iterative deepening, returns the best move of the last completed iteration
+Move Search::start() {
+	start_time = std::chrono::steady_clock::now();
+	allocate_time();
+	nodes = 0;
+	tb_hits = 0;
+	ply = 0;
+	completed_depth = 0;
+	best_score = 0;
+	ponder_move = PackedMove();
+	ponderhit_time = -1;
+	lines.clear();
+
+	// Helpers search the same position until this search is done
+	std::vector<std::thread> helper_threads;
+	for(auto &helper : helpers) {
+		helper->board = board;
+		helper->tt = tt;
+		helper->tablebases = tablebases;
+		helper->options = options;
+		helper->limits = SearchLimits();
+		helper->limits.depth = limits.depth;
+		helper->quiet = true;
+		helper->nodes = 0;
+		helper->stop = false;
+		Search *search = helper.get();
+		int thread = helper_threads.size() + 1;
+		helper_threads.emplace_back([search, thread]() {
+			int64_t trace_begin = trace_start();
+			search->start();
+			trace_span("helper search", trace_begin, "thread", thread);
+		});
+	}
+
+	Move best_move;
+	for(int depth = start_depth; depth <= limits.depth && depth < MAX_PLY; depth++) {
+		int64_t trace_begin = trace_start();
+		uint64_t nodes_before = nodes;
+		line_floor = multi_pv > 1 && lines.size() == multi_pv ? lines.back().score - multi_pv_margin : -INF_SCORE;
+		int score = negamax(-INF_SCORE, INF_SCORE, depth, false);
+		if(multi_pv > 1 && !stop && root_lines.size() < multi_pv && line_floor > -INF_SCORE) {
+			line_floor = -INF_SCORE;
+			score = negamax(-INF_SCORE, INF_SCORE, depth, false);
+		}
+		if(stop && completed_depth >= 1) {
+			trace_span("iteration", trace_begin, "depth", depth);
+			break;
+		}
+		completed_depth = depth;
+		best_score = score;
+		if(pv_length[0] > 0) {
+			best_move = board.unpack_move(pv_table[0][0]);
+			ponder_move = pv_length[0] > 1 ? pv_table[0][1] : PackedMove();
+		}
+		if(multi_pv > 1) {
+			lines = root_lines;
+		}
+		if(!quiet && multi_pv > 1) {
+			for(int line = 0; line < lines.size(); line++) {
+				print_info(depth, lines[line].score, line, lines[line].pv);
+			}
+		} else if(!quiet) {
+			print_info(depth, score, 0, std::vector<PackedMove>(pv_table[0], pv_table[0] + pv_length[0]));
+		}
+		trace_span("iteration", trace_begin, "depth", depth);
+		if(statistics_enabled && !stop) {
+			iteration_nodes[depth] += nodes - nodes_before;
+		}
+		if(stop) {
+			break;
+		}
+
+		// Another iteration would most likely not finish in time
+		if(!pondering && soft_limit && elapsed() >= soft_limit / 2) {
+			break;
+		}
+	}
+
+	// A ponder search only answers once the opponent has moved (ponderhit) or it is stopped
+	while(pondering && !stop) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	for(auto &helper : helpers) {
+		helper->stop = true;
+	}
+	for(std::thread &thread : helper_threads) {
+		thread.join();
+	}
+
+	// Fall back to any legal move if the search was stopped before finding one
+	if(best_move == Move()) {
+		std::vector<Move> &move_list = move_lists[0];
+		board.legal_moves(move_list);
+		if(!move_list.empty()) {
+			best_move = move_list[0];
+		}
+	}
+
+	// Without a reply in the principal variation, the hash move after the best move will do
+	if(best_move != Move() && ponder_move == PackedMove()) {
+		TTEntry entry;
+		board.make_move(best_move);
+		if(tt->probe(board.hash_key, entry)) {
+			std::vector<Move> &move_list = move_lists[0];
+			board.legal_moves(move_list);
+			for(Move move : move_list) {
+				if(PackedMove(move) == entry.move) {
+					ponder_move = entry.move;
+				}
+			}
+		}
+		board.unmake_move(best_move);
+	}
+	return best_move;
+}
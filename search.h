@@ -0,0 +1,147 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "board.h"
+#include "tt.h"
+#include "tablebase.h"
+#include "material.h"
+#include "stats.h"
+
+const int INF_SCORE = 32000;
+const int MATE_SCORE = 31000;
+const int MAX_PLY = 128;
+
+// Selective search techniques, each can be switched off to compare fixed-depth runs
+struct SearchOptions {
+    bool null_move_pruning = true;
+    bool late_move_reductions = true;
+    bool reverse_futility_pruning = true;
+    bool futility_pruning = true;
+    bool late_move_pruning = true;
+
+    // Generate pseudo-legal moves and check each one only when it is tried
+    bool pseudo_legal = false;
+};
+
+// Limits given by the go command, zero means no limit
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;
+    int64_t movetime = 0;
+    int64_t time [2] = {0, 0};
+    int64_t increment [2] = {0, 0};
+    int movestogo = 0;
+    bool infinite = false;
+    bool ponder = false; // Started on the opponent's time, in the position after the expected reply
+};
+
+// Search tree counters for one remaining depth or one ply (only collected with -DSTATS)
+struct TreeCounters {
+    uint64_t nodes;
+    uint64_t tt_cutoffs;
+    uint64_t fail_highs;
+    uint64_t first_move_cutoffs;
+    uint64_t cutoff_index_sum; // Index of the cutoff move, counting from zero
+    uint64_t lmr_researches;
+    uint64_t pvs_researches;
+};
+
+// One line of a MultiPV search: its exact score and principal variation
+struct RootLine {
+    int score;
+    std::vector<PackedMove> pv;
+};
+
+class Search {
+public:
+    Search();
+
+    // Search state
+    Board board;
+    TranspositionTable *tt;
+    Tablebases *tablebases = nullptr;
+    MaterialTable material_table;
+    SearchOptions options;
+    SearchLimits limits;
+    std::atomic<bool> stop;
+    uint64_t nodes;
+    uint64_t tb_hits;
+    int ply;
+    int completed_depth;
+    int best_score; // Score of the last completed iteration
+    PackedMove ponder_move; // Expected reply to the best move, if known
+    bool quiet = false; // No info lines, for batch analysis
+
+    // MultiPV: the root keeps its best multi_pv moves with their lines, and searches every other
+    // move against the score of the last of them. One pass over the root finds all the lines.
+    // Moves must also beat a floor just below the last line of the previous iteration, and the
+    // iteration is searched again without it when fewer lines than asked for are left.
+    int multi_pv = 1;
+    int line_floor = -INF_SCORE;
+    std::vector<RootLine> root_lines; // Best first, filled by the iteration in progress
+    std::vector<RootLine> lines; // Of the last completed iteration
+
+    // Lazy SMP: helpers search the same position with the shared transposition table until this
+    // search finishes. They print nothing and have no limits of their own.
+    std::vector<std::unique_ptr<Search>> helpers;
+    int start_depth = 1; // Odd helpers start an iteration deeper so the threads spread out
+    void set_threads(int threads);
+    uint64_t total_nodes();
+
+    // Tree statistics by remaining depth (0 for quiescence nodes) and by ply, and nodes per
+    // iteration for the branching factor. Kept across searches until reset.
+    TreeCounters depth_counters [MAX_PLY];
+    TreeCounters ply_counters [MAX_PLY];
+    uint64_t iteration_nodes [MAX_PLY];
+    void count_tree(int depth, uint64_t TreeCounters::*counter, uint64_t value = 1) {
+        if(statistics_enabled) {
+            depth_counters[std::min(std::max(depth, 0), MAX_PLY - 1)].*counter += value;
+            ply_counters[ply].*counter += value;
+        }
+    }
+    void reset_tree_statistics();
+    void print_tree_statistics(const char *prefix);
+
+    // Time management (milliseconds)
+    std::chrono::steady_clock::time_point start_time;
+    int64_t soft_limit;
+    int64_t hard_limit;
+    int64_t elapsed();
+    void allocate_time();
+    void check_limits();
+
+    // A ponder search has no time limit while pondering is set. Clearing it (ponderhit) starts the
+    // clock for the hard limit, while the time already spent counts toward the soft limit.
+    std::atomic<bool> pondering;
+    int64_t ponderhit_time; // elapsed() when the search saw the ponderhit, -1 before
+
+    // Principal variation (triangular table)
+    PackedMove pv_table [MAX_PLY] [MAX_PLY];
+    int pv_length [MAX_PLY];
+
+    // Move ordering
+    PackedMove killers [MAX_PLY] [2];
+    int history [4096]; // [from_to]
+    std::vector<Move> move_lists [MAX_PLY];
+    int move_scores [MAX_PLY] [256];
+    void score_moves(std::vector<Move> &move_list, PackedMove tt_move);
+    Move pick_move(std::vector<Move> &move_list, int index);
+
+    // Late move reductions [depth] [moves searched]
+    int reductions [64] [64];
+
+    void clear();
+    Move start();
+    int negamax(int alpha, int beta, int depth, bool null_allowed);
+    int quiescence(int alpha, int beta);
+    bool has_non_pawn_material();
+    void print_info(int depth, int score, int line, const std::vector<PackedMove> &pv);
+};
+
+#endif
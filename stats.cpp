@@ -0,0 +1,98 @@
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include "stats.h"
+
+// Counters of the running threads, and the sum of those that have ended
+std::mutex statistics_mutex;
+std::vector<Statistics *> live_statistics;
+Statistics retired_statistics = {};
+
+StatisticsSlot::StatisticsSlot() {
+	statistics = new Statistics();
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	live_statistics.push_back(statistics);
+}
+
+StatisticsSlot::~StatisticsSlot() {
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	for(int i = 0; i < STAT_COUNT; i++) {
+		retired_statistics.counters[i] += statistics->counters[i];
+	}
+	for(int i = 0; i < live_statistics.size(); i++) {
+		if(live_statistics[i] == statistics) {
+			live_statistics.erase(live_statistics.begin() + i);
+			break;
+		}
+	}
+	delete statistics;
+}
+
+void reset_statistics() {
+	std::lock_guard<std::mutex> lock(statistics_mutex);
+	retired_statistics = {};
+	for(Statistics *statistics : live_statistics) {
+		*statistics = {};
+	}
+}
+
+void print_statistics(bool json) {
+	if(!statistics_enabled) {
+		std::cout << "info string statistics are not compiled in (build with -DSTATS)" << std::endl;
+		return;
+	}
+	uint64_t totals [STAT_COUNT];
+	{
+		std::lock_guard<std::mutex> lock(statistics_mutex);
+		for(int i = 0; i < STAT_COUNT; i++) {
+			totals[i] = retired_statistics.counters[i];
+			for(Statistics *statistics : live_statistics) {
+				totals[i] += statistics->counters[i];
+			}
+		}
+	}
+
+	std::vector<std::pair<std::string, uint64_t>> rows = {
+		{"nodes", totals[STAT_NODES]},
+		{"qsearch_nodes", totals[STAT_QSEARCH_NODES]},
+		{"legal_moves_calls", totals[STAT_GENERATIONS]},
+		{"legal_moves_generated", totals[STAT_MOVES_GENERATED]},
+		{"generations_not_in_check", totals[STAT_NO_CHECK]},
+		{"generations_single_check", totals[STAT_SINGLE_CHECK]},
+		{"generations_double_check", totals[STAT_DOUBLE_CHECK]},
+		{"pseudo_legal_moves_calls", totals[STAT_PSEUDO_GENERATIONS]},
+		{"pseudo_legal_moves_generated", totals[STAT_PSEUDO_MOVES_GENERATED]},
+		{"legality_checks", totals[STAT_LEGALITY_CHECKS]},
+		{"make_moves", totals[STAT_MAKE_MOVES]},
+		{"unmake_moves", totals[STAT_UNMAKE_MOVES]},
+		{"tt_probes", totals[STAT_TT_PROBES]},
+		{"tt_hits", totals[STAT_TT_HITS]},
+		{"cutoffs", totals[STAT_CUTOFFS]}
+	};
+	for(int i = 0; i < 8; i++) {
+		rows.push_back({"cutoffs_move_" + std::to_string(i + 1) + (i == 7 ? "_plus" : ""), totals[STAT_CUTOFF_MOVE_1 + i]});
+	}
+
+	if(json) {
+		std::cout << "{";
+		for(int i = 0; i < rows.size(); i++) {
+			std::cout << (i ? ", " : "") << "\"" << rows[i].first << "\": " << rows[i].second;
+		}
+		std::cout << "}" << std::endl;
+		return;
+	}
+
+	for(auto &row : rows) {
+		std::cout << std::left << std::setw(30) << row.first << std::right << std::setw(16) << row.second << "\n";
+	}
+	// Derived ratios
+	auto ratio = [](uint64_t a, uint64_t b) {
+		return b ? (double)a / b : 0.0;
+	};
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::left << std::setw(30) << "moves_per_legal_moves_call" << std::right << std::setw(16) << ratio(totals[STAT_MOVES_GENERATED], totals[STAT_GENERATIONS]) << "\n";
+	std::cout << std::left << std::setw(30) << "tt_hit_rate" << std::right << std::setw(16) << ratio(totals[STAT_TT_HITS], totals[STAT_TT_PROBES]) << "\n";
+	std::cout << std::left << std::setw(30) << "first_move_cutoff_rate" << std::right << std::setw(16) << ratio(totals[STAT_CUTOFF_MOVE_1], totals[STAT_CUTOFFS]) << std::endl;
+	std::cout << std::defaultfloat;
+}
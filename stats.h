@@ -0,0 +1,49 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+
+// Hot path counters are only compiled in with -DSTATS. Otherwise count() is empty and every
+// call disappears.
+#ifdef STATS
+const bool statistics_enabled = true;
+#else
+const bool statistics_enabled = false;
+#endif
+
+enum statistics {
+    STAT_NODES, STAT_QSEARCH_NODES,
+    STAT_GENERATIONS, STAT_MOVES_GENERATED, STAT_NO_CHECK, STAT_SINGLE_CHECK, STAT_DOUBLE_CHECK,
+    STAT_PSEUDO_GENERATIONS, STAT_PSEUDO_MOVES_GENERATED, STAT_LEGALITY_CHECKS,
+    STAT_MAKE_MOVES, STAT_UNMAKE_MOVES,
+    STAT_TT_PROBES, STAT_TT_HITS,
+    STAT_CUTOFFS, STAT_CUTOFF_MOVE_1, // Then one counter per move index, the last for every later move
+    STAT_COUNT = STAT_CUTOFF_MOVE_1 + 8
+};
+
+// Counters of one thread, on cache lines of their own so threads never share one
+struct alignas(64) Statistics {
+    uint64_t counters [STAT_COUNT];
+};
+
+// Registers the thread's counters on first use and folds them into the totals when the thread ends
+struct StatisticsSlot {
+    Statistics *statistics;
+
+    StatisticsSlot();
+    ~StatisticsSlot();
+};
+
+inline thread_local StatisticsSlot local_statistics;
+
+inline void count(int statistic, uint64_t value = 1) {
+    if(statistics_enabled) {
+        local_statistics.statistics->counters[statistic] += value;
+    }
+}
+
+// Zero the counters of every thread. Totals are exact once the threads are idle.
+void reset_statistics();
+void print_statistics(bool json);
+
+#endif
@@ -0,0 +1,748 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "tablebase.h"
+#include "bits.h"
+
+// File layout: header, block offsets (blocks + 1, relative to the first block), then the blocks of
+// (value, run length - 1) byte pairs
+struct TablebaseHeader {
+	uint32_t magic;
+	uint32_t block_size;
+	uint64_t entries;
+	uint64_t blocks;
+	char name [16];
+};
+const uint32_t tablebase_magic = 0x31425443; // "CTB1"
+const int tablebase_block_size = 1024;
+
+// Entries that are never probed (unused indices)
+const int tablebase_unused = 255;
+
+const char tablebase_letters[6] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+
+// White king squares left by the symmetry reduction
+const int triangle_squares[10] = {a1, b1, c1, d1, b2, c2, d2, c3, d3, d4};
+
+int king_positions(bool pawns) {
+	return pawns ? 32 : 10;
+}
+
+int reduced_king(int square, bool pawns) {
+	if(pawns) {
+		return (square >> 3) * 4 + (square & 7);
+	}
+	for(int i = 0; i < 10; i++) {
+		if(triangle_squares[i] == square) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int king_from_reduced(int index, bool pawns) {
+	return pawns ? (index / 4) * 8 + index % 4 : triangle_squares[index];
+}
+
+// Mirror files (1), ranks (2) and the a1-h8 diagonal (4)
+inline int transform_square(int square, int transform) {
+	if(transform & 1) {
+		square ^= 7;
+	}
+	if(transform & 2) {
+		square ^= 56;
+	}
+	if(transform & 4) {
+		square = ((square & 7) << 3) | (square >> 3);
+	}
+	return square;
+}
+
+// Index of the position after a symmetry transform, identical pieces listed by square
+uint64_t transformed_index(const TablebaseMaterial &material, const int squares[], int side, int transform) {
+	int reduced [4];
+	for(int i = 0; i < material.count; i++) {
+		reduced[i] = transform_square(squares[i], transform);
+	}
+	for(int i = 3; i < material.count; i++) {
+		if(material.pieces[i] == material.pieces[i - 1] && reduced[i] < reduced[i - 1]) {
+			std::swap(reduced[i], reduced[i - 1]);
+		}
+	}
+
+	uint64_t index = side * king_positions(material.pawns) + reduced_king(reduced[0], material.pawns);
+	for(int i = 1; i < material.count; i++) {
+		index = index * 64 + reduced[i];
+	}
+	return index;
+}
+
+// Index of a position given the squares of the pieces in table order
+uint64_t tablebase_index(const TablebaseMaterial &material, const int squares[], int side) {
+	int file = squares[0] & 7;
+	int rank = squares[0] >> 3;
+	int transform = 0;
+	if(file > 3) {
+		transform |= 1;
+		file = 7 - file;
+	}
+	if(!material.pawns) {
+		if(rank > 3) {
+			transform |= 2;
+			rank = 7 - rank;
+		}
+		if(rank > file) {
+			transform |= 4;
+		} else if(rank == file) {
+			// On the diagonal both mirror images keep the king in place: the smaller index is the one stored
+			return std::min(transformed_index(material, squares, side, transform), transformed_index(material, squares, side, transform | 4));
+		}
+	}
+	return transformed_index(material, squares, side, transform);
+}
+
+void tablebase_squares(const TablebaseMaterial &material, uint64_t index, int squares[], int &side) {
+	for(int i = material.count - 1; i > 0; i--) {
+		squares[i] = index & 63;
+		index >>= 6;
+	}
+	int kings = king_positions(material.pawns);
+	squares[0] = king_from_reduced(index % kings, material.pawns);
+	side = index / kings;
+}
+
+bool TablebaseMaterial::set(std::vector<int> white, std::vector<int> black) {
+	std::sort(white.rbegin(), white.rend());
+	std::sort(black.rbegin(), black.rend());
+	bool swapped = black.size() > white.size() || (black.size() == white.size() && black > white);
+	if(swapped) {
+		std::swap(white, black);
+	}
+	count = 0;
+	pieces[count++] = WK;
+	pieces[count++] = BK;
+	pawns = false;
+	for(int type : white) {
+		pieces[count++] = type * 2;
+		pawns = pawns || type == 0;
+	}
+	for(int type : black) {
+		pieces[count++] = type * 2 + 1;
+		pawns = pawns || type == 0;
+	}
+	return swapped;
+}
+
+bool TablebaseMaterial::parse(std::string name) {
+	std::vector<int> sides [2];
+	int color = -1;
+	for(char letter : name) {
+		if(letter == 'K') {
+			color++;
+			continue;
+		}
+		const char *type = std::find(tablebase_letters, tablebase_letters + 5, letter);
+		if(color < 0 || color > 1 || type == tablebase_letters + 5) {
+			if(letter != 'v') {
+				return false;
+			}
+			continue;
+		}
+		sides[color].push_back(type - tablebase_letters);
+	}
+	if(color != 1 || sides[0].size() + sides[1].size() < 1 || sides[0].size() + sides[1].size() > 2) {
+		return false;
+	}
+	set(sides[0], sides[1]);
+	return true;
+}
+
+std::string TablebaseMaterial::name() {
+	std::string text [2] = {"K", "K"};
+	for(int i = 2; i < count; i++) {
+		text[pieces[i] & 1] += tablebase_letters[pieces[i] >> 1];
+	}
+	return text[WHITE] + "v" + text[BLACK];
+}
+
+uint64_t TablebaseMaterial::signature(bool flipped) {
+	uint64_t key = 0;
+	for(int i = 2; i < count; i++) {
+		key += 1ULL << (4 * (flipped ? pieces[i] ^ 1 : pieces[i]));
+	}
+	return key;
+}
+
+uint64_t TablebaseMaterial::size() {
+	return 2ULL * king_positions(pawns) << (6 * (count - 1));
+}
+
+Tablebase::~Tablebase() {
+	close();
+}
+
+bool Tablebase::open(std::string path) {
+	close();
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0) {
+		return false;
+	}
+	struct stat status;
+	if(fstat(file, &status) < 0 || status.st_size < sizeof(TablebaseHeader)) {
+		::close(file);
+		return false;
+	}
+	void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if(mapping == MAP_FAILED) {
+		return false;
+	}
+	data = (const unsigned char *)mapping;
+	size = status.st_size;
+
+	TablebaseHeader header;
+	memcpy(&header, data, sizeof(header));
+	header.name[15] = 0;
+	if(header.magic != tablebase_magic || header.block_size != tablebase_block_size || !material.parse(header.name) ||
+		header.entries != material.size() || header.blocks != (header.entries + tablebase_block_size - 1) / tablebase_block_size) {
+		close();
+		return false;
+	}
+	uint64_t blocks_start = sizeof(header) + (header.blocks + 1) * sizeof(uint32_t);
+	offsets = (const uint32_t *)(data + sizeof(header));
+	blocks = data + blocks_start;
+	entries = header.entries;
+	// A truncated or damaged file would otherwise fault or read past the mapping during a probe
+	if(blocks_start > size || !valid_blocks(header.blocks, size - blocks_start)) {
+		close();
+		return false;
+	}
+	// Probes jump around the file
+	madvise(mapping, size, MADV_RANDOM);
+	return true;
+}
+
+// Offsets rising from zero to the end of the file, and runs that cover each block exactly, so
+// entry() stays inside its block. One pass over the file, which is far smaller than the table.
+bool Tablebase::valid_blocks(uint64_t count, uint64_t length) {
+	if(offsets[0] != 0 || offsets[count] != length) {
+		return false;
+	}
+	for(uint64_t block = 0; block < count; block++) {
+		if(offsets[block] > offsets[block + 1] || (offsets[block + 1] - offsets[block]) % 2) {
+			return false;
+		}
+		uint64_t covered = 0;
+		for(uint32_t run = offsets[block]; run < offsets[block + 1]; run += 2) {
+			covered += blocks[run + 1] + 1;
+		}
+		if(covered != std::min<uint64_t>(tablebase_block_size, entries - block * tablebase_block_size)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Tablebase::close() {
+	if(data) {
+		munmap((void *)data, size);
+	}
+	data = nullptr;
+	size = 0;
+	entries = 0;
+}
+
+int Tablebase::entry(uint64_t index) {
+	uint64_t block = index / tablebase_block_size;
+	int remaining = index % tablebase_block_size;
+	const unsigned char *run = blocks + offsets[block];
+	while(remaining > run[1]) {
+		remaining -= run[1] + 1;
+		run += 2;
+	}
+	return run[0];
+}
+
+int Tablebases::open(std::string directory) {
+	close();
+	DIR *folder = opendir(directory.c_str());
+	if(!folder) {
+		return 0;
+	}
+	while(dirent *file = readdir(folder)) {
+		std::string name = file->d_name;
+		if(name.size() > 3 && name.compare(name.size() - 3, 3, ".tb") == 0) {
+			add(directory + "/" + name);
+		}
+	}
+	closedir(folder);
+	return tables.size();
+}
+
+bool Tablebases::add(std::string path) {
+	std::unique_ptr<Tablebase> table(new Tablebase());
+	if(!table->open(path)) {
+		return false;
+	}
+	lookup[table->material.signature(false)] = {table.get(), false};
+	lookup.emplace(table->material.signature(true), std::make_pair(table.get(), true));
+	max_pieces = std::max(max_pieces, table->material.count);
+	tables.push_back(std::move(table));
+	return true;
+}
+
+void Tablebases::close() {
+	lookup.clear();
+	tables.clear();
+	max_pieces = 0;
+}
+
+bool Tablebases::probe(Board &board, int &result, int &distance) {
+	if(board.castling_rights.back() || board.en_passant_square.back() != 64) {
+		return false;
+	}
+	auto found = lookup.find(board.material_key);
+	if(found == lookup.end()) {
+		return false;
+	}
+	Tablebase &table = *found->second.first;
+	bool flipped = found->second.second;
+
+	// Squares in table order, seen from the side that is white in the table
+	uint64_t bitboards [12];
+	for(int piece = WP; piece <= BK; piece++) {
+		bitboards[piece] = board.bitboards[flipped ? piece ^ 1 : piece];
+	}
+	int squares [4];
+	for(int i = 0; i < table.material.count; i++) {
+		int square = return_lsb(bitboards[table.material.pieces[i]]);
+		squares[i] = flipped ? square ^ 56 : square;
+	}
+	// Unused entries hold a neighbour's value in the file, so only an index that decodes back to
+	// itself may be read
+	int side = flipped ? !board.side : board.side;
+	uint64_t index = tablebase_index(table.material, squares, side);
+	int canonical [4];
+	int canonical_side;
+	tablebase_squares(table.material, index, canonical, canonical_side);
+	if(tablebase_index(table.material, canonical, canonical_side) != index) {
+		return false;
+	}
+	int value = table.entry(index);
+	result = value == 0 ? 0 : ((value - 1) & 1 ? 1 : -1);
+	distance = value == 0 ? 0 : value - 1;
+	return true;
+}
+
+// Table being generated, in memory
+struct Generation {
+	TablebaseMaterial material;
+	Tablebases *tables;
+	std::vector<uint8_t> values; // 0 until resolved, otherwise as stored in the file
+	std::vector<std::vector<uint32_t>> buckets; // Positions to resolve at each distance
+};
+
+// Set up a position from the squares of the pieces, false if it is not a legal position
+bool setup_position(Board &board, const TablebaseMaterial &material, const int squares[], int side) {
+	uint64_t occupied = 0;
+	for(int i = 0; i < material.count; i++) {
+		if(occupied & (1ULL << squares[i])) {
+			return false;
+		}
+		occupied |= 1ULL << squares[i];
+	}
+	board.clear_position();
+	for(int i = 0; i < material.count; i++) {
+		board.bitboards[material.pieces[i]] |= 1ULL << squares[i];
+		board.piece_list[squares[i]] = material.pieces[i];
+	}
+	board.side = side;
+	board.castling_rights.push_back(0);
+	board.en_passant_square.push_back(64);
+	board.halfmove_clock.push_back(0);
+	board.fullmove_number = 1;
+	return board.complete_position();
+}
+
+// Stored value of the position after a move: probed from a smaller table after captures and
+// promotions, read from the table being generated otherwise
+int child_value(Generation &generation, Board &board, const int squares[], Move move) {
+	if(move.capture() != E || move.promote()) {
+		board.make_move(move);
+		int result = 0;
+		int distance = 0;
+		// Only the kings left is a draw
+		if(pop_count(board.occupancies[BOTH]) > 2) {
+			generation.tables->probe(board, result, distance);
+		}
+		board.unmake_move(move);
+		return result ? distance + 1 : 0;
+	}
+	int child [4];
+	for(int i = 0; i < generation.material.count; i++) {
+		child[i] = squares[i] == move.source() ? move.target() : squares[i];
+	}
+	return generation.values[tablebase_index(generation.material, child, !board.side)];
+}
+
+// Distance (plies) at which the position is lost once every move leads to a won position for the
+// opponent, or 0 while some move does not
+int loss_distance(Generation &generation, Board &board, const int squares[], std::vector<Move> &move_list) {
+	board.legal_moves(move_list);
+	int distance = 0;
+	for(Move move : move_list) {
+		int value = child_value(generation, board, squares, move);
+		if(value == 0 || !((value - 1) & 1)) {
+			return 0;
+		}
+		distance = std::max(distance, value);
+	}
+	return distance;
+}
+
+// Mates, stalemates and the results reached straight through captures and promotions
+void initial_pass(Generation &generation, Board board, uint64_t begin, uint64_t end, std::vector<std::vector<uint32_t>> &buckets) {
+	std::vector<Move> move_list;
+	int squares [4];
+	int side;
+	for(uint64_t index = begin; index < end; index++) {
+		tablebase_squares(generation.material, index, squares, side);
+		// Indices of mirrored positions and of swapped identical pieces are never probed
+		if(tablebase_index(generation.material, squares, side) != index || !setup_position(board, generation.material, squares, side)) {
+			generation.values[index] = tablebase_unused;
+			continue;
+		}
+		board.legal_moves(move_list);
+		if(move_list.empty()) {
+			if(board.in_check()) {
+				buckets[0].push_back(index);
+			}
+			continue;
+		}
+		int win = 0;
+		int loss = 0;
+		bool all_lost = true;
+		for(Move move : move_list) {
+			if(move.capture() == E && !move.promote()) {
+				all_lost = false;
+				continue;
+			}
+			int value = child_value(generation, board, squares, move);
+			if(value && !((value - 1) & 1)) {
+				win = win ? std::min(win, value) : value;
+			}
+			if(value == 0 || !((value - 1) & 1)) {
+				all_lost = false;
+			}
+			loss = std::max(loss, value);
+		}
+		if(win) {
+			buckets[win].push_back(index);
+		} else if(all_lost) {
+			buckets[loss].push_back(index);
+		}
+	}
+}
+
+// Predecessors of positions resolved at distance: after a loss they are won one ply later,
+// after a win they are lost once all of their moves lead to won positions
+void propagate(Generation &generation, Board board, const std::vector<uint32_t> &resolved, uint64_t begin, uint64_t end, int distance, std::vector<std::vector<uint32_t>> &buckets) {
+	TablebaseMaterial &material = generation.material;
+	std::vector<Move> move_list;
+	int squares [4];
+	int previous [4];
+	int side;
+	for(uint64_t i = begin; i < end; i++) {
+		tablebase_squares(material, resolved[i], squares, side);
+		uint64_t occupied = 0;
+		for(int j = 0; j < material.count; j++) {
+			occupied |= 1ULL << squares[j];
+		}
+		// Take back every non-capturing move of the side that just moved
+		int mover = !side;
+		for(int j = 0; j < material.count; j++) {
+			int piece = material.pieces[j];
+			if((piece & 1) != mover) {
+				continue;
+			}
+			int square = squares[j];
+			uint64_t origins;
+			if(piece >> 1 == 0) {
+				int back = mover == WHITE ? square - 8 : square + 8;
+				bool single = mover == WHITE ? square >= 16 : square <= 47;
+				origins = single && !(occupied & (1ULL << back)) ? 1ULL << back : 0;
+				int rank = square >> 3;
+				if(origins && rank == (mover == WHITE ? 3 : 4)) {
+					int start = mover == WHITE ? square - 16 : square + 16;
+					origins |= (occupied & (1ULL << start)) ? 0 : 1ULL << start;
+				}
+			} else {
+				origins = board.piece_attacks(piece, square, occupied) & ~occupied;
+			}
+			for(; origins; pop_lsb(origins)) {
+				std::copy(squares, squares + material.count, previous);
+				previous[j] = lsb(origins);
+				uint64_t index = tablebase_index(material, previous, mover);
+				if(generation.values[index]) {
+					continue;
+				}
+				if(!(distance & 1)) {
+					buckets[distance + 1].push_back(index);
+					continue;
+				}
+				int parent_side;
+				tablebase_squares(material, index, previous, parent_side);
+				setup_position(board, material, previous, parent_side);
+				int loss = loss_distance(generation, board, previous, move_list);
+				if(loss) {
+					buckets[loss].push_back(index);
+				}
+			}
+		}
+	}
+}
+
+// Self check: every stored value must follow from the values of the position's moves one ply on
+void check_pass(Generation &generation, Board board, uint64_t begin, uint64_t end, std::atomic<uint64_t> &errors) {
+	std::vector<Move> move_list;
+	int squares [4];
+	int side;
+	for(uint64_t index = begin; index < end; index++) {
+		if(generation.values[index] == tablebase_unused) {
+			continue;
+		}
+		tablebase_squares(generation.material, index, squares, side);
+		setup_position(board, generation.material, squares, side);
+		board.legal_moves(move_list);
+		int expected = board.in_check() ? 1 : 0;
+		int win = 0;
+		int loss = 0;
+		for(Move move : move_list) {
+			int value = child_value(generation, board, squares, move);
+			if(value == tablebase_unused) {
+				win = tablebase_unused;
+				break;
+			}
+			if(value && !((value - 1) & 1)) {
+				win = win ? std::min(win, value + 1) : value + 1;
+			}
+			loss = value == 0 || loss < 0 ? -1 : std::max(loss, value + 1);
+		}
+		if(!move_list.empty()) {
+			expected = win ? win : std::max(loss, 0);
+		}
+		if(generation.values[index] != expected) {
+			errors++;
+		}
+	}
+}
+
+// Run-length code the values block by block, filling unused entries with their neighbour's value
+bool write_tablebase(Generation &generation, std::string path) {
+	std::vector<uint8_t> &values = generation.values;
+	uint8_t last = 0;
+	for(uint8_t &value : values) {
+		value = value == tablebase_unused ? last : value;
+		last = value;
+	}
+	uint64_t blocks = (values.size() + tablebase_block_size - 1) / tablebase_block_size;
+	std::vector<uint32_t> offsets;
+	std::vector<uint8_t> runs;
+	for(uint64_t block = 0; block < blocks; block++) {
+		offsets.push_back(runs.size());
+		uint64_t end = std::min<uint64_t>(values.size(), (block + 1) * tablebase_block_size);
+		for(uint64_t i = block * tablebase_block_size; i < end;) {
+			uint64_t j = i + 1;
+			while(j < end && j - i < 256 && values[j] == values[i]) {
+				j++;
+			}
+			runs.push_back(values[i]);
+			runs.push_back(j - i - 1);
+			i = j;
+		}
+	}
+	offsets.push_back(runs.size());
+
+	TablebaseHeader header = {tablebase_magic, tablebase_block_size, values.size(), blocks, {}};
+	strncpy(header.name, generation.material.name().c_str(), sizeof(header.name) - 1);
+	FILE *file = fopen(path.c_str(), "wb");
+	if(!file) {
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+	success = success && fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size();
+	success = success && fwrite(runs.data(), 1, runs.size(), file) == runs.size();
+	return fclose(file) == 0 && success;
+}
+
+// Merge the buckets filled by the threads into the generation's buckets
+void merge_buckets(Generation &generation, std::vector<std::vector<std::vector<uint32_t>>> &local) {
+	for(auto &buckets : local) {
+		for(int distance = 0; distance < buckets.size(); distance++) {
+			generation.buckets[distance].insert(generation.buckets[distance].end(), buckets[distance].begin(), buckets[distance].end());
+			buckets[distance].clear();
+		}
+	}
+}
+
+bool generate_table(Board &board, Tablebases &tables, TablebaseMaterial material, std::string path, int threads) {
+	auto start = std::chrono::steady_clock::now();
+	Generation generation;
+	generation.material = material;
+	generation.tables = &tables;
+	generation.values.assign(material.size(), 0);
+	generation.buckets.resize(tablebase_unused);
+	std::vector<std::vector<std::vector<uint32_t>>> local(threads, std::vector<std::vector<uint32_t>>(tablebase_unused));
+
+	std::vector<std::thread> workers;
+	uint64_t size = material.size();
+	for(int i = 0; i < threads; i++) {
+		workers.emplace_back(initial_pass, std::ref(generation), std::cref(board), size * i / threads, size * (i + 1) / threads, std::ref(local[i]));
+	}
+	for(std::thread &worker : workers) {
+		worker.join();
+	}
+	merge_buckets(generation, local);
+
+	// Resolve positions in order of distance, so the first result found for a position is its shortest
+	int longest = 0;
+	for(int distance = 0; distance < tablebase_unused - 1; distance++) {
+		std::vector<uint32_t> &bucket = generation.buckets[distance];
+		std::sort(bucket.begin(), bucket.end());
+		bucket.erase(std::unique(bucket.begin(), bucket.end()), bucket.end());
+		std::vector<uint32_t> resolved;
+		for(uint32_t index : bucket) {
+			if(!generation.values[index]) {
+				generation.values[index] = distance + 1;
+				resolved.push_back(index);
+			}
+		}
+		bucket = std::vector<uint32_t>();
+		if(!resolved.empty()) {
+			longest = distance;
+		}
+
+		workers.clear();
+		for(int i = 0; i < threads; i++) {
+			uint64_t begin = resolved.size() * i / threads;
+			uint64_t end = resolved.size() * (i + 1) / threads;
+			workers.emplace_back(propagate, std::ref(generation), std::cref(board), std::cref(resolved), begin, end, distance, std::ref(local[i]));
+		}
+		for(std::thread &worker : workers) {
+			worker.join();
+		}
+		merge_buckets(generation, local);
+	}
+
+	uint64_t wins = 0;
+	uint64_t losses = 0;
+	uint64_t draws = 0;
+	for(uint8_t value : generation.values) {
+		wins += value && value != tablebase_unused && ((value - 1) & 1);
+		losses += value && value != tablebase_unused && !((value - 1) & 1);
+		draws += value == 0;
+	}
+	std::atomic<uint64_t> errors(0);
+	workers.clear();
+	for(int i = 0; i < threads; i++) {
+		workers.emplace_back(check_pass, std::ref(generation), std::cref(board), size * i / threads, size * (i + 1) / threads, std::ref(errors));
+	}
+	for(std::thread &worker : workers) {
+		worker.join();
+	}
+	if(errors) {
+		std::cout << material.name() << " failed its self check in " << errors << " positions" << std::endl;
+		return false;
+	}
+
+	bool success = write_tablebase(generation, path);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << material.name() << " wins " << wins << " losses " << losses << " draws " << draws << " longest " << longest << " plies";
+	std::cout << " time " << seconds << "s" << std::endl;
+	return success && tables.add(path);
+}
+
+// Generate a table after the tables its captures and promotions lead to
+bool generate_with_dependencies(Board &board, Tablebases &tables, TablebaseMaterial material, std::string directory, int threads) {
+	if(tables.lookup.count(material.signature(false))) {
+		return true;
+	}
+	std::vector<int> sides [2];
+	for(int i = 2; i < material.count; i++) {
+		sides[material.pieces[i] & 1].push_back(material.pieces[i] >> 1);
+	}
+	for(int color = WHITE; color <= BLACK; color++) {
+		for(int i = 0; i < sides[color].size(); i++) {
+			// Captures remove a piece, promotions turn a pawn into another piece
+			std::vector<std::vector<int>> changes;
+			std::vector<int> captured = sides[color];
+			captured.erase(captured.begin() + i);
+			changes.push_back(captured);
+			if(sides[color][i] == 0) {
+				for(int type = 1; type <= 4; type++) {
+					std::vector<int> promoted = sides[color];
+					promoted[i] = type;
+					changes.push_back(promoted);
+				}
+			}
+			for(std::vector<int> &changed : changes) {
+				if(changed.size() + sides[!color].size() == 0) {
+					continue;
+				}
+				TablebaseMaterial smaller;
+				smaller.set(color == WHITE ? changed : sides[WHITE], color == BLACK ? changed : sides[BLACK]);
+				if(!generate_with_dependencies(board, tables, smaller, directory, threads)) {
+					return false;
+				}
+			}
+		}
+	}
+	return generate_table(board, tables, material, directory + "/" + material.name() + ".tb", threads);
+}
+
+bool generate_tablebases(Board &board, std::string directory, std::vector<std::string> names, int threads) {
+	Tablebases tables;
+	tables.open(directory);
+	threads = std::max(1, threads);
+
+	std::vector<TablebaseMaterial> materials;
+	for(std::string &name : names) {
+		TablebaseMaterial material;
+		if(name == "3" || name == "4") {
+			// Every split of 1 or 2 pieces between the sides
+			for(int first = 0; first < 5; first++) {
+				if(name == "3") {
+					material.set({first}, {});
+					materials.push_back(material);
+					continue;
+				}
+				for(int second = 0; second <= first; second++) {
+					material.set({first, second}, {});
+					materials.push_back(material);
+					material.set({first}, {second});
+					materials.push_back(material);
+				}
+			}
+		} else if(material.parse(name)) {
+			materials.push_back(material);
+		} else {
+			std::cout << "unknown table " << name << "\n";
+			return false;
+		}
+	}
+	for(TablebaseMaterial &material : materials) {
+		if(!generate_with_dependencies(board, tables, material, directory, threads)) {
+			std::cout << "could not write " << material.name() << "\n";
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "board.h"
+
+// Pieces of an ending in table order: white king, black king, then the other white pieces and the
+// other black pieces from strongest to weakest. The stronger side is always white in a table.
+struct TablebaseMaterial {
+    int pieces [4];
+    int count = 0;
+    bool pawns = false;
+
+    // Set up from lists of piece types (without the kings), swapping colors if black is stronger.
+    // Returns true when the colors were swapped.
+    bool set(std::vector<int> white, std::vector<int> black);
+    bool parse(std::string name); // "KQvKR", either side first
+    std::string name();
+    uint64_t signature(bool flipped); // As Board::material_key
+    uint64_t size();
+};
+
+// Distance to mate for one ending, one byte per position: 0 for a draw and plies + 1 otherwise (odd
+// plies when the side to move wins). Positions are reduced by symmetry (the white king is moved to
+// a1-d1-d4, or to files a-d with pawns) and the bytes are run-length coded in blocks behind an offset
+// table, so one block is decoded per probe. Indices that symmetry leaves unused repeat a neighbour.
+class Tablebase {
+public:
+    ~Tablebase();
+
+    TablebaseMaterial material;
+    const unsigned char *data = nullptr;
+    uint64_t size = 0;
+    uint64_t entries = 0;
+    const uint32_t *offsets = nullptr;
+    const unsigned char *blocks = nullptr;
+
+    bool open(std::string path);
+    bool valid_blocks(uint64_t count, uint64_t length);
+    void close();
+    int entry(uint64_t index);
+};
+
+// All tables found in a directory, probed by the material of a position
+class Tablebases {
+public:
+    std::vector<std::unique_ptr<Tablebase>> tables;
+    std::unordered_map<uint64_t, std::pair<Tablebase *, bool>> lookup; // Signature -> table, colors swapped
+    int max_pieces = 0;
+
+    // Returns the number of tables opened
+    int open(std::string directory);
+    bool add(std::string path);
+    void close();
+
+    // Result for the side to move (1 win, 0 draw, -1 loss) and the distance to mate in plies.
+    // False without a table for the material, or with castling rights or an en passant square.
+    bool probe(Board &board, int &result, int &distance);
+};
+
+// Generate the named tables ("KQvKR", or "3" and "4" for every 3 or 4 piece ending) into directory,
+// together with the smaller tables they resolve captures and promotions with
+bool generate_tablebases(Board &board, std::string directory, std::vector<std::string> names, int threads);
+
+#endif
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "trace.h"
+
+const auto trace_epoch = std::chrono::steady_clock::now();
+
+// Every buffer handed out, and those whose threads have ended (reused by the next thread)
+std::mutex trace_mutex;
+std::vector<TraceBuffer *> trace_buffers;
+std::vector<TraceBuffer *> free_trace_buffers;
+
+int64_t trace_clock() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count();
+}
+
+TraceSlot::TraceSlot() {
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	if(!free_trace_buffers.empty()) {
+		buffer = free_trace_buffers.back();
+		free_trace_buffers.pop_back();
+	} else {
+		buffer = new TraceBuffer();
+		buffer->thread = trace_buffers.size();
+		trace_buffers.push_back(buffer);
+	}
+}
+
+TraceSlot::~TraceSlot() {
+	std::lock_guard<std::mutex> lock(trace_mutex);
+	free_trace_buffers.push_back(buffer);
+}
+
+// UCI notation of a PackedMove
+void write_move(FILE *file, int64_t value) {
+	int source = value & 0x3f;
+	int target = (value >> 6) & 0x3f;
+	int code = (value >> 12) & 0xf;
+	fprintf(file, "\"%c%c%c%c", 'a' + (source & 7), '1' + (source >> 3), 'a' + (target & 7), '1' + (target >> 3));
+	if(code > 4) {
+		fputc("nbrq"[code - 5], file);
+	}
+	fputc('"', file);
+}
+
+// Chrome trace event JSON of every buffer, written when the program exits
+struct TraceWriter {
+	~TraceWriter() {
+		if(!tracing_enabled) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(trace_mutex);
+		FILE *file = fopen("trace.json", "w");
+		if(!file) {
+			return;
+		}
+		fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+		bool first = true;
+		for(TraceBuffer *buffer : trace_buffers) {
+			uint64_t begin = buffer->written > trace_buffer_size ? buffer->written - trace_buffer_size : 0;
+			for(uint64_t i = begin; i < buffer->written; i++) {
+				TraceEvent &event = buffer->events[i % trace_buffer_size];
+				fprintf(file, "%s{\"name\": \"%s\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f", first ? "" : ",\n", event.name, buffer->thread, event.start / 1000.0);
+				if(event.duration >= 0) {
+					fprintf(file, ", \"ph\": \"X\", \"dur\": %.3f", event.duration / 1000.0);
+				} else {
+					fprintf(file, ", \"ph\": \"i\", \"s\": \"t\"");
+				}
+				if(event.argument) {
+					fprintf(file, ", \"args\": {\"%s\": ", event.argument);
+					if(!strcmp(event.argument, "move")) {
+						write_move(file, event.value);
+					} else {
+						fprintf(file, "%lld", (long long)event.value);
+					}
+					fputc('}', file);
+				}
+				fputc('}', file);
+				first = false;
+			}
+		}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+	}
+} trace_writer;
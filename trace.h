@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Timeline events for a trace viewer, only compiled in with -DTRACE. Every thread writes to a ring
+// buffer of its own without locking; at exit the buffers are written to trace.json in the Chrome
+// trace event format. Without -DTRACE every call below is empty.
+#ifdef TRACE
+const bool tracing_enabled = true;
+#else
+const bool tracing_enabled = false;
+#endif
+
+// Events kept per thread, older ones are overwritten
+const int trace_buffer_size = 1 << 14;
+
+struct TraceEvent {
+    const char *name;
+    const char *argument; // Name of value, "move" for a PackedMove, or nullptr
+    int64_t value;
+    int64_t start;        // Nanoseconds since the tracer started
+    int64_t duration;     // Negative for an instant event
+};
+
+struct TraceBuffer {
+    TraceEvent events [trace_buffer_size];
+    uint64_t written = 0;
+    int thread;
+};
+
+// Takes a buffer on first use and hands it back, events included, when the thread ends
+struct TraceSlot {
+    TraceBuffer *buffer;
+
+    TraceSlot();
+    ~TraceSlot();
+};
+
+inline thread_local TraceSlot local_trace;
+
+int64_t trace_clock();
+
+inline void record_event(const char *name, const char *argument, int64_t value, int64_t start, int64_t duration) {
+    TraceBuffer *buffer = local_trace.buffer;
+    TraceEvent &event = buffer->events[buffer->written++ % trace_buffer_size];
+    event.name = name;
+    event.argument = argument;
+    event.value = value;
+    event.start = start;
+    event.duration = duration;
+}
+
+// Start time of a span, to be passed to trace_span when it ends
+inline int64_t trace_start() {
+    return tracing_enabled ? trace_clock() : 0;
+}
+
+inline void trace_span(const char *name, int64_t start, const char *argument = nullptr, int64_t value = 0) {
+    if(tracing_enabled) {
+        record_event(name, argument, value, start, trace_clock() - start);
+    }
+}
+
+inline void trace_instant(const char *name, const char *argument = nullptr, int64_t value = 0) {
+    if(tracing_enabled) {
+        record_event(name, argument, value, trace_clock(), -1);
+    }
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "tt.h"
+#include "huge_pages.h"
+#include "stats.h"
+#include "trace.h"
+
+const uint32_t tt_magic = 0x31545443; // "CTT1"
+const uint32_t tt_version = 1;
+
+TTFileHeader tt_header(uint64_t entries) {
+	return {tt_magic, tt_version, (uint32_t)sizeof(TTEntry), 16, entries};
+}
+
+// A table written by this version with the same entry layout, and a file of the right length
+bool valid_header(const TTFileHeader &header, uint64_t length) {
+	return header.magic == tt_magic && header.version == tt_version && header.entry_size == sizeof(TTEntry) && header.key_bits == 16 &&
+		header.entries > 0 && length == tt_header_size + header.entries * sizeof(TTEntry);
+}
+
+// Whole buffer reads and writes, at disk bandwidth rather than per entry
+bool write_all(int file, const void *data, uint64_t length) {
+	const char *position = (const char *)data;
+	while(length > 0) {
+		ssize_t written = write(file, position, length);
+		if(written <= 0) {
+			return false;
+		}
+		position += written;
+		length -= written;
+	}
+	return true;
+}
+
+bool read_all(int file, void *data, uint64_t length) {
+	char *position = (char *)data;
+	while(length > 0) {
+		ssize_t done = read(file, position, length);
+		if(done <= 0) {
+			return false;
+		}
+		position += done;
+		length -= done;
+	}
+	return true;
+}
+
+TranspositionTable::~TranspositionTable() {
+	release();
+}
+
+bool TranspositionTable::resize(int megabytes) {
+	int64_t trace_begin = trace_start();
+	release();
+	this->megabytes = megabytes;
+	uint64_t entries = ((uint64_t)megabytes << 20) / sizeof(TTEntry);
+	entries = entries > 0 ? entries : 1;
+	bool mapped = file_backed && map_file(entries);
+	if(!mapped && !allocate(entries)) {
+		allocate(1);
+	}
+	trace_span("tt resize", trace_begin, "megabytes", megabytes);
+	return mapped || !file_backed;
+}
+
+// Anonymous memory in huge pages, which starts out zero (empty entries)
+bool TranspositionTable::allocate(uint64_t entries) {
+	void *memory = allocate_large(entries * sizeof(TTEntry), "hash table");
+	if(!memory) {
+		return false;
+	}
+	mapping = memory;
+	mapping_size = entries * sizeof(TTEntry);
+	table = (TTEntry *)memory;
+	size = entries;
+	return true;
+}
+
+// Shared mapping of file_path, so every store reaches the file without being written out. A table
+// saved there is mapped at its own size, any other existing file is left alone.
+bool TranspositionTable::map_file(uint64_t entries) {
+	int file = open(file_path.c_str(), O_RDWR);
+	bool created = file < 0 && errno == ENOENT;
+	if(created) {
+		file = open(file_path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	if(file < 0) {
+		return false;
+	}
+	struct stat status;
+	TTFileHeader header;
+	if(!created) {
+		if(fstat(file, &status) < 0 || pread(file, &header, sizeof(header), 0) != sizeof(header) || !valid_header(header, status.st_size)) {
+			close(file);
+			return false;
+		}
+		entries = header.entries;
+	}
+	uint64_t length = tt_header_size + entries * sizeof(TTEntry);
+	// A new file is zero filled, so every entry starts out empty
+	if(created && ftruncate(file, length) < 0) {
+		close(file);
+		unlink(file_path.c_str());
+		return false;
+	}
+	void *memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if(memory == MAP_FAILED) {
+		if(created) {
+			unlink(file_path.c_str());
+		}
+		return false;
+	}
+	if(created) {
+		header = tt_header(entries);
+		memcpy(memory, &header, sizeof(header));
+	}
+	madvise(memory, length, MADV_RANDOM);
+	mapping = memory;
+	mapping_size = length;
+	table = (TTEntry *)((char *)memory + tt_header_size);
+	size = entries;
+	megabytes = (entries * sizeof(TTEntry)) >> 20;
+	return true;
+}
+
+void TranspositionTable::release() {
+	// Anonymous tables start at the mapping, file-backed ones after the header
+	if((void *)table == mapping) {
+		free_large(mapping);
+	} else if(mapping) {
+		munmap(mapping, mapping_size);
+	}
+	mapping = nullptr;
+	mapping_size = 0;
+	table = nullptr;
+	size = 0;
+}
+
+void TranspositionTable::clear() {
+	memset((void *)table, 0, size * sizeof(TTEntry));
+}
+
+// Written to a temporary file first, so an interrupted save keeps the previous one
+bool TranspositionTable::save() {
+	if(file_path.empty()) {
+		return false;
+	}
+	// A file-backed table only needs flushing
+	if((void *)table != mapping) {
+		return msync(mapping, mapping_size, MS_SYNC) == 0;
+	}
+	std::string temporary = file_path + ".tmp";
+	int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(file < 0) {
+		return false;
+	}
+	char header [tt_header_size] = {};
+	TTFileHeader file_header = tt_header(size);
+	memcpy(header, &file_header, sizeof(file_header));
+	bool written = write_all(file, header, tt_header_size) && write_all(file, table, size * sizeof(TTEntry));
+	written = close(file) == 0 && written;
+	if(!written || rename(temporary.c_str(), file_path.c_str()) < 0) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TranspositionTable::load() {
+	int file = open(file_path.c_str(), O_RDONLY);
+	if(file < 0) {
+		return false;
+	}
+	struct stat status;
+	TTFileHeader header;
+	if(fstat(file, &status) < 0 || !read_all(file, &header, sizeof(header)) || !valid_header(header, status.st_size)) {
+		close(file);
+		return false;
+	}
+	release();
+	megabytes = (header.entries * sizeof(TTEntry)) >> 20;
+	// A file-backed table simply maps the saved one
+	if(file_backed) {
+		close(file);
+		if(map_file(header.entries)) {
+			return true;
+		}
+		allocate(1);
+		return false;
+	}
+	bool loaded = allocate(header.entries) && lseek(file, tt_header_size, SEEK_SET) == tt_header_size && read_all(file, table, header.entries * sizeof(TTEntry));
+	close(file);
+	if(!loaded) {
+		release();
+		allocate(1);
+	}
+	return loaded;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) {
+	entry = table[index(key)];
+	bool hit = entry.flag != TT_NONE && entry.key == (uint16_t)key;
+	count(STAT_TT_PROBES);
+	count(STAT_TT_HITS, hit);
+	return hit;
+}
+
+// Replace entries from other positions, or the same position searched to a lower depth
+void TranspositionTable::store(uint64_t key, PackedMove move, int score, int depth, int flag) {
+	TTEntry &entry = table[index(key)];
+	uint16_t check = key;
+	if(entry.key == check && depth < entry.depth && flag != TT_EXACT) {
+		return;
+	}
+
+	// Keep the old best move if this search did not find one
+	if(move == PackedMove() && entry.key == check) {
+		move = entry.move;
+	}
+	entry = {check, move, (int16_t)score, (int8_t)depth, (uint8_t)flag};
+}
@@ -0,0 +1,68 @@
+#ifndef TT_H
+#define TT_H
+
+#include <cstdint>
+#include <string>
+#include "move.h"
+
+// Bound stored with a score
+enum tt_flags {TT_NONE, TT_EXACT, TT_LOWER, TT_UPPER};
+
+// 8 byte entry: the index uses the high bits of the zobrist key and the low 16 bits verify it.
+// Moves read back are only trusted once they match a generated legal move.
+struct TTEntry {
+    uint16_t key;
+    PackedMove move;
+    int16_t score;
+    int8_t depth;
+    uint8_t flag;
+};
+
+// Saved and file-backed tables start with this header, padded to a page so the entries behind it
+// can be mapped directly
+struct TTFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t key_bits; // Bits of the zobrist key kept in an entry
+    uint64_t entries;
+};
+const int tt_header_size = 4096;
+
+// Single-entry transposition table indexed by the board's zobrist key. The entries live in an
+// anonymous mapping, or in a shared mapping of file_path (the HashFile option) when file_backed is set, so that a long
+// analysis survives restarts.
+class TranspositionTable {
+public:
+    ~TranspositionTable();
+
+    TTEntry *table = nullptr;
+    uint64_t size = 0;
+    int megabytes = 0;
+    std::string file_path;
+    bool file_backed = false;
+    void *mapping = nullptr;
+    uint64_t mapping_size = 0;
+
+    // A file-backed table maps the table saved in file_path at its saved size, or creates the file
+    // when there is none. False (with an empty in-memory table) when the file cannot be mapped or
+    // holds something else.
+    bool resize(int megabytes);
+    bool allocate(uint64_t entries);
+    bool map_file(uint64_t entries);
+    void release();
+    void clear();
+    bool probe(uint64_t key, TTEntry &entry);
+    void store(uint64_t key, PackedMove move, int score, int depth, int flag);
+
+    // Write the entries to file_path, or replace the table (size included) with the one saved there
+    bool save();
+    bool load();
+
+    // Map the full key range onto the table without needing a power of two size
+    uint64_t index(uint64_t key) {
+        return (uint64_t)(((unsigned __int128)key * size) >> 64);
+    }
+};
+
+#endif
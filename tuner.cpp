@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "tuner.h"
+#include "board.h"
+#include "bits.h"
+#include "psqt.h"
+#include "pgn.h"
+
+// Tuned weights: middlegame then endgame value of each piece type on each table square (a8 first)
+const int tuner_entries = 6 * 64;
+const int tuner_parameters = 2 * tuner_entries;
+
+// Positions evaluated together, so the dense part of the loss runs over contiguous arrays
+const int tuner_block = 64;
+
+struct TunerFeature {
+	uint16_t index;
+	int16_t coefficient; // White minus black pieces on the entry
+};
+
+// The positions of one thread
+struct TunerPartition {
+	std::vector<uint32_t> offsets; // Features of position i are [offsets[i], offsets[i + 1])
+	std::vector<TunerFeature> features;
+	std::vector<float> phase;      // Middlegame share of the evaluation (0 to 1)
+	std::vector<float> target;
+	std::vector<double> gradient;
+	double loss;
+};
+
+// Reduce positions [begin, end) to sparse features
+void extract_features(const PositionReader &reader, uint64_t begin, uint64_t end, double lambda, double k, TunerPartition &partition) {
+	int coefficients [tuner_entries] = {};
+	std::vector<int> touched;
+	partition.offsets.push_back(0);
+	for(uint64_t i = begin; i < end; i++) {
+		const PackedPosition &position = reader[i];
+		if(position.result > WHITE_WIN || pop_count(position.occupancy) > 32) {
+			continue;
+		}
+		int phase = 0;
+		int index = 0;
+		for(uint64_t occupancy = position.occupancy; occupancy; index++) {
+			int square = return_lsb(occupancy);
+			int piece = (position.pieces[index >> 1] >> ((index & 1) * 4)) & 15;
+			if(piece >= E) {
+				continue;
+			}
+			int type = piece >> 1;
+			int entry = type * 64 + ((piece & 1) ? square : square ^ 56);
+			if(coefficients[entry] == 0) {
+				touched.push_back(entry);
+			}
+			coefficients[entry] += (piece & 1) ? -1 : 1;
+			phase += phase_increment[type];
+		}
+		for(int entry : touched) {
+			if(coefficients[entry]) {
+				partition.features.push_back({(uint16_t)entry, (int16_t)coefficients[entry]});
+			}
+			coefficients[entry] = 0;
+		}
+		touched.clear();
+		partition.offsets.push_back(partition.features.size());
+
+		// Targets are from white's point of view, scores are stored for the side to move
+		double score = (position.state >> 7) ? -position.score : position.score;
+		double result = position.result / 2.0;
+		partition.phase.push_back(std::min(phase, 24) / 24.0f);
+		partition.target.push_back(lambda * result + (1 - lambda) / (1 + std::pow(10.0, -k * score / 400)));
+	}
+	partition.gradient.assign(tuner_parameters, 0);
+}
+
+// e^x to within 4e-6 relative error, built from 2^n in the exponent bits and a polynomial for 2^f with
+// |f| <= 0.5. Unlike expf it is not a library call, so the loop using it vectorizes. The argument is
+// clamped to +-126 on its bits: float comparisons would keep GCC from if-converting the loop unless
+// -fno-trapping-math is given.
+inline float vector_exp(float x) {
+	float t = x * 1.44269504f;
+	int32_t bits;
+	memcpy(&bits, &t, sizeof(bits));
+	bits = (bits & (int32_t)0x80000000) | std::min(bits & 0x7fffffff, 0x42fc0000);
+	memcpy(&t, &bits, sizeof(t));
+	// Round to nearest by adding and removing 1.5 * 2^23
+	float n = (t + 12582912.0f) - 12582912.0f;
+	float f = t - n;
+	float p = 1.54035304e-4f;
+	p = p * f + 1.33335581e-3f;
+	p = p * f + 9.61812911e-3f;
+	p = p * f + 5.55041087e-2f;
+	p = p * f + 2.40226507e-1f;
+	p = p * f + 6.93147181e-1f;
+	p = p * f + 1.0f;
+	int32_t power_bits = ((int32_t)n + 127) << 23;
+	float power;
+	memcpy(&power, &power_bits, sizeof(power));
+	return p * power;
+}
+
+// Mean squared error over one partition, adding the gradient of the summed error when asked
+void partition_loss(TunerPartition &partition, const std::vector<float> &weights, float scale, bool gradient) {
+	const float *mg_weights = weights.data();
+	const float *eg_weights = weights.data() + tuner_entries;
+	float mg [tuner_block];
+	float eg [tuner_block];
+	float phase [tuner_block];
+	float target [tuner_block];
+	float error [tuner_block];
+	float mg_gradient [tuner_block];
+	float eg_gradient [tuner_block];
+	double loss = 0;
+	uint64_t positions = partition.phase.size();
+
+	for(uint64_t first = 0; first < positions; first += tuner_block) {
+		int count = std::min<uint64_t>(tuner_block, positions - first);
+		// Sparse sums of the tables, with the block copied out so the dense part always runs over
+		// tuner_block local entries
+		for(int i = 0; i < count; i++) {
+			float mg_sum = 0;
+			float eg_sum = 0;
+			for(uint32_t f = partition.offsets[first + i]; f < partition.offsets[first + i + 1]; f++) {
+				mg_sum += partition.features[f].coefficient * mg_weights[partition.features[f].index];
+				eg_sum += partition.features[f].coefficient * eg_weights[partition.features[f].index];
+			}
+			mg[i] = mg_sum;
+			eg[i] = eg_sum;
+			phase[i] = partition.phase[first + i];
+			target[i] = partition.target[first + i];
+		}
+		// A partial block is padded with zeros that are left out of the loss and gradient
+		for(int i = count; i < tuner_block; i++) {
+			mg[i] = eg[i] = phase[i] = target[i] = 0;
+		}
+		// Dense, branch-free part over the block, vectorized by the compiler at -O2 (which needs a fixed
+		// trip count and no library calls)
+		for(int i = 0; i < tuner_block; i++) {
+			float eval = mg[i] * phase[i] + eg[i] * (1 - phase[i]);
+			float sigmoid = 1 / (1 + vector_exp(-scale * eval));
+			float difference = sigmoid - target[i];
+			error[i] = difference * difference;
+			float slope = 2 * difference * sigmoid * (1 - sigmoid) * scale;
+			mg_gradient[i] = slope * phase[i];
+			eg_gradient[i] = slope * (1 - phase[i]);
+		}
+		for(int i = 0; i < count; i++) {
+			loss += error[i];
+		}
+		if(!gradient) {
+			continue;
+		}
+		// Scatter the gradient back onto the table entries
+		double *mg_total = partition.gradient.data();
+		double *eg_total = partition.gradient.data() + tuner_entries;
+		for(int i = 0; i < count; i++) {
+			for(uint32_t f = partition.offsets[first + i]; f < partition.offsets[first + i + 1]; f++) {
+				mg_total[partition.features[f].index] += mg_gradient[i] * partition.features[f].coefficient;
+				eg_total[partition.features[f].index] += eg_gradient[i] * partition.features[f].coefficient;
+			}
+		}
+	}
+	partition.loss = loss;
+}
+
+// Mean loss over all partitions, run on one thread per partition
+double dataset_loss(std::vector<TunerPartition> &partitions, const std::vector<float> &weights, double k, bool gradient) {
+	// sigmoid(k * eval / 400) in base 10 is the logistic function of k * ln(10) / 400 * eval
+	float scale = k * std::log(10.0) / 400;
+	std::vector<std::thread> workers;
+	for(TunerPartition &partition : partitions) {
+		if(gradient) {
+			std::fill(partition.gradient.begin(), partition.gradient.end(), 0.0);
+		}
+		workers.emplace_back(partition_loss, std::ref(partition), std::cref(weights), scale, gradient);
+	}
+	double loss = 0;
+	uint64_t positions = 0;
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+		loss += partitions[i].loss;
+		positions += partitions[i].phase.size();
+	}
+	return loss / std::max<uint64_t>(positions, 1);
+}
+
+// Ternary search for the scale that best fits the starting tables
+double fit_scale(std::vector<TunerPartition> &partitions, const std::vector<float> &weights) {
+	double low = 0.01;
+	double high = 3.0;
+	for(int i = 0; i < 25; i++) {
+		double a = low + (high - low) / 3;
+		double b = high - (high - low) / 3;
+		if(dataset_loss(partitions, weights, a, false) < dataset_loss(partitions, weights, b, false)) {
+			high = b;
+		} else {
+			low = a;
+		}
+	}
+	return (low + high) / 2;
+}
+
+void write_table(FILE *file, const char *name, const int table [6] [64]) {
+	const char *types[6] = {"Pawn", "Knight", "Bishop", "Rook", "Queen", "King"};
+	fprintf(file, "const int %s[6][64] = {\n", name);
+	for(int type = 0; type < 6; type++) {
+		fprintf(file, "    // %s\n    {\n", types[type]);
+		for(int row = 0; row < 8; row++) {
+			fprintf(file, "        ");
+			for(int column = 0; column < 8; column++) {
+				fprintf(file, "%4d%s", table[type][row * 8 + column], row == 7 && column == 7 ? "" : ",");
+				fprintf(file, column == 7 ? "\n" : " ");
+			}
+		}
+		fprintf(file, "    }%s\n", type == 5 ? "" : ",");
+	}
+	fprintf(file, "};\n\n");
+}
+
+// Split the tuned entries back into piece values (mean over the squares a piece can stand on) and
+// piece-square tables, and write them in the layout of psqt.h
+bool write_tables(std::string path, const std::vector<float> &weights, double loss) {
+	int values [2] [6];
+	int tables [2] [6] [64];
+	for(int stage = 0; stage < 2; stage++) {
+		for(int type = 0; type < 6; type++) {
+			const float *entries = weights.data() + stage * tuner_entries + type * 64;
+			// Pawns never stand on the first or last row
+			int first = type == 0 ? 8 : 0;
+			int last = type == 0 ? 56 : 64;
+			double sum = 0;
+			for(int square = first; square < last; square++) {
+				sum += entries[square];
+			}
+			values[stage][type] = type == 5 ? 0 : (int)std::lround(sum / (last - first));
+			for(int square = 0; square < 64; square++) {
+				bool used = square >= first && square < last;
+				tables[stage][type][square] = used ? (int)std::lround(entries[square]) - values[stage][type] : 0;
+			}
+		}
+	}
+
+	FILE *file = fopen(path.c_str(), "w");
+	if(!file) {
+		return false;
+	}
+	fprintf(file, "#ifndef PSQT_H\n#define PSQT_H\n\n");
+	fprintf(file, "// Tapered material and piece-square tables, Texel tuned (mean squared error %.6f)\n", loss);
+	fprintf(file, "// Tables are laid out as seen from white with a8 first, so white pieces index with square ^ 56\n\n");
+	fprintf(file, "// Piece values in pawn, knight, bishop, rook, queen, king order\n");
+	const char *names[2] = {"mg_value", "eg_value"};
+	for(int stage = 0; stage < 2; stage++) {
+		fprintf(file, "const int %s[6] = {", names[stage]);
+		for(int type = 0; type < 6; type++) {
+			fprintf(file, "%d%s", values[stage][type], type == 5 ? "};\n" : ", ");
+		}
+	}
+	fprintf(file, "\n");
+	write_table(file, "mg_pst", tables[0]);
+	write_table(file, "eg_pst", tables[1]);
+	fprintf(file, "// Contribution of each piece type to the game phase (24 = all pieces on the board)\n");
+	fprintf(file, "const int phase_increment[6] = {0, 1, 1, 2, 4, 0};\n\n#endif\n");
+	return fclose(file) == 0;
+}
+
+bool tune_evaluation(TunerSettings &settings) {
+	auto start = std::chrono::steady_clock::now();
+	auto seconds = [&]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+	PositionReader reader;
+	if(!reader.open(settings.input)) {
+		std::cout << "could not open " << settings.input << "\n";
+		return false;
+	}
+
+	// Starting point: the current tables
+	std::vector<float> weights(tuner_parameters);
+	for(int type = 0; type < 6; type++) {
+		for(int square = 0; square < 64; square++) {
+			weights[type * 64 + square] = mg_value[type] + mg_pst[type][square];
+			weights[tuner_entries + type * 64 + square] = eg_value[type] + eg_pst[type][square];
+		}
+	}
+
+	// Features are extracted once, each thread keeping the partition it evaluates afterwards
+	int threads = std::max(1, settings.threads);
+	double score_scale = settings.k ? settings.k : 1.0;
+	std::vector<TunerPartition> partitions(threads);
+	std::vector<std::thread> workers;
+	for(int i = 0; i < threads; i++) {
+		uint64_t begin = reader.size * i / threads;
+		uint64_t end = reader.size * (i + 1) / threads;
+		workers.emplace_back(extract_features, std::cref(reader), begin, end, settings.lambda, score_scale, std::ref(partitions[i]));
+	}
+	uint64_t positions = 0;
+	for(int i = 0; i < threads; i++) {
+		workers[i].join();
+		positions += partitions[i].phase.size();
+	}
+	std::cout << "positions " << positions << " of " << reader.size << " loaded in " << seconds() << "s" << std::endl;
+	reader.close();
+	if(positions == 0) {
+		return false;
+	}
+
+	double k = settings.k ? settings.k : fit_scale(partitions, weights);
+	std::cout << "k " << k << " loss " << dataset_loss(partitions, weights, k, false) << std::endl;
+
+	// Full-batch Adam
+	const double beta1 = 0.9;
+	const double beta2 = 0.999;
+	const double epsilon = 1e-8;
+	std::vector<double> momentum(tuner_parameters, 0);
+	std::vector<double> velocity(tuner_parameters, 0);
+	double loss = 0;
+	for(int epoch = 1; epoch <= settings.epochs; epoch++) {
+		loss = dataset_loss(partitions, weights, k, true);
+		double correction1 = 1 - std::pow(beta1, epoch);
+		double correction2 = 1 - std::pow(beta2, epoch);
+		for(int p = 0; p < tuner_parameters; p++) {
+			double gradient = 0;
+			for(TunerPartition &partition : partitions) {
+				gradient += partition.gradient[p];
+			}
+			gradient /= positions;
+			momentum[p] = beta1 * momentum[p] + (1 - beta1) * gradient;
+			velocity[p] = beta2 * velocity[p] + (1 - beta2) * gradient * gradient;
+			weights[p] -= settings.rate * (momentum[p] / correction1) / (std::sqrt(velocity[p] / correction2) + epsilon);
+		}
+		if(epoch % 50 == 0 || epoch == settings.epochs) {
+			std::cout << "epoch " << epoch << " loss " << loss << " time " << seconds() << "s" << std::endl;
+			if(!write_tables(settings.output, weights, loss)) {
+				std::cout << "could not write " << settings.output << "\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
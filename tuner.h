@@ -0,0 +1,22 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <string>
+
+struct TunerSettings {
+    std::string input;      // Packed positions with known game results
+    std::string output;     // Header written in the layout of psqt.h
+    int epochs = 1000;
+    double rate = 1.0;      // Adam step size in centipawns
+    double lambda = 1.0;    // Weight of the game result against the recorded search score
+    double k = 0;           // Sigmoid scale, fitted to the data when zero
+    int threads = 1;
+};
+
+// Texel tuning of the material and piece-square tables. Every position is reduced once to its phase,
+// its target and a sparse list of (table entry, white minus black count) coefficients, which makes the
+// evaluation linear in the tables. Epochs then run full-batch Adam on the mean squared error between
+// the target and sigmoid(k * eval), with each thread evaluating its own share of the positions.
+bool tune_evaluation(TunerSettings &settings);
+
+#endif
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <memory>
+#include "uci.h"
+#include "search.h"
+#include "perft.h"
+#include "stats.h"
+#include "huge_pages.h"
+#include "book.h"
+
+// Find the legal move written in long algebraic notation, or an empty move if there is none
+Move parse_move(Board &board, std::string text) {
+	std::vector<Move> move_list;
+	board.legal_moves(move_list);
+	for(int i = 0; i < move_list.size(); i++) {
+		if(board.move_to_uci(move_list[i]) == text) {
+			return move_list[i];
+		}
+	}
+	return Move();
+}
+
+// position [startpos | fen <fen>] [moves <move> ...]
+void parse_position(Board &board, std::istringstream &stream) {
+	std::string token, fen;
+	stream >> token;
+	if(token == "startpos") {
+		fen = start_position;
+		stream >> token;
+	} else if(token == "fen") {
+		while(stream >> token && token != "moves") {
+			fen += token + " ";
+		}
+	} else {
+		return;
+	}
+	if(!board.initialize_fen(fen)) {
+		std::cout << "info string invalid fen " << fen << std::endl;
+		board.initialize_fen(start_position);
+		return;
+	}
+
+	if(token == "moves") {
+		while(stream >> token) {
+			Move move = parse_move(board, token);
+			if(move == Move()) {
+				std::cout << "info string illegal move " << token << std::endl;
+				break;
+			}
+			board.make_move(move);
+		}
+	}
+}
+
+void parse_go(SearchLimits &limits, std::istringstream &stream) {
+	limits = SearchLimits();
+	std::string token;
+	while(stream >> token) {
+		if(token == "depth") {
+			stream >> limits.depth;
+		} else if(token == "nodes") {
+			stream >> limits.nodes;
+		} else if(token == "movetime") {
+			stream >> limits.movetime;
+		} else if(token == "wtime") {
+			stream >> limits.time[WHITE];
+		} else if(token == "btime") {
+			stream >> limits.time[BLACK];
+		} else if(token == "winc") {
+			stream >> limits.increment[WHITE];
+		} else if(token == "binc") {
+			stream >> limits.increment[BLACK];
+		} else if(token == "movestogo") {
+			stream >> limits.movestogo;
+		} else if(token == "infinite") {
+			limits.infinite = true;
+		} else if(token == "ponder") {
+			limits.ponder = true;
+		}
+	}
+}
+
+// A file-backed table keeps the size it was saved with, which may differ from the one asked for
+void resize_hash(TranspositionTable &tt, int megabytes) {
+	if(!tt.resize(megabytes)) {
+		std::cout << "info string could not map hash file " << tt.file_path << " (not a saved hash table or not writable)" << std::endl;
+	} else if(tt.file_backed && tt.megabytes != megabytes) {
+		std::cout << "info string hash file " << tt.file_path << " keeps its saved size of " << tt.megabytes << " MB" << std::endl;
+	}
+}
+
+// setoption name <name> value <value>
+void parse_setoption(Board &board, Search &search, TranspositionTable &tt, Book &book, Tablebases &tablebases, std::istringstream &stream) {
+	std::string token, name, value;
+	stream >> token;
+	while(stream >> token && token != "value") {
+		name += (name.empty() ? "" : " ") + token;
+	}
+	std::getline(stream >> std::ws, value);
+	bool enabled = value == "true";
+
+	if(name == "Hash") {
+		resize_hash(tt, std::stoi(value));
+	} else if(name == "HashFile") {
+		tt.file_path = value == "<empty>" ? "" : value;
+		if(tt.file_backed) {
+			resize_hash(tt, tt.megabytes);
+		}
+	} else if(name == "PersistentHash") {
+		tt.file_backed = enabled && !tt.file_path.empty();
+		resize_hash(tt, tt.megabytes);
+	} else if(name == "SaveHash") {
+		std::cout << "info string " << (tt.save() ? "saved hash to " : "could not save hash to ") << tt.file_path << std::endl;
+	} else if(name == "LoadHash") {
+		std::cout << "info string " << (tt.load() ? "loaded hash from " : "could not load hash from ") << tt.file_path << std::endl;
+	} else if(name == "NullMovePruning") {
+		search.options.null_move_pruning = enabled;
+	} else if(name == "LateMoveReductions") {
+		search.options.late_move_reductions = enabled;
+	} else if(name == "ReverseFutilityPruning") {
+		search.options.reverse_futility_pruning = enabled;
+	} else if(name == "FutilityPruning") {
+		search.options.futility_pruning = enabled;
+	} else if(name == "LateMovePruning") {
+		search.options.late_move_pruning = enabled;
+	} else if(name == "Ponder") {
+		// Nothing to set up: the GUI decides when to send go ponder
+	} else if(name == "MultiPV") {
+		search.multi_pv = std::max(1, std::stoi(value));
+	} else if(name == "Threads") {
+		search.set_threads(std::max(1, std::stoi(value)));
+	} else if(name == "PseudoLegalMoves") {
+		search.options.pseudo_legal = enabled;
+	} else if(name == "IncrementalAttacks") {
+		board.set_incremental_attacks(enabled);
+	} else if(name == "BookFile") {
+		if(value.empty() || value == "<empty>") {
+			book.close();
+		} else if(!book.open(value)) {
+			std::cout << "info string could not open book " << value << std::endl;
+		}
+	} else if(name == "BookSelection") {
+		book.weighted = value == "weighted";
+	} else if(name == "TablebasePath") {
+		tablebases.close();
+		search.tablebases = nullptr;
+		if(!value.empty() && value != "<empty>") {
+			std::cout << "info string " << tablebases.open(value) << " tablebases found" << std::endl;
+			search.tablebases = tablebases.tables.empty() ? nullptr : &tablebases;
+		}
+	} else {
+		std::cout << "info string unknown option " << name << std::endl;
+	}
+}
+
+void uci_loop(Board &board) {
+	TranspositionTable tt;
+	tt.resize(16);
+	std::unique_ptr<Search> search(new Search());
+	search->tt = &tt;
+	print_large_pages("info string ");
+	Book book;
+	Tablebases tablebases;
+	std::thread search_thread;
+
+	// Halt a running search before the position or tables change
+	auto stop_search = [&]() {
+		search->stop = true;
+		if(search_thread.joinable()) {
+			search_thread.join();
+		}
+	};
+
+	std::string line, command;
+	while(std::getline(std::cin, line)) {
+		std::istringstream stream(line);
+		command.clear();
+		stream >> command;
+
+		if(command == "uci") {
+			std::cout << "id name Yet Another Chess Engine\n";
+			std::cout << "id author Shadowfacts1272\n";
+			std::cout << "option name Hash type spin default 16 min 1 max 65536\n";
+			std::cout << "option name HashFile type string default <empty>\n";
+			std::cout << "option name PersistentHash type check default false\n";
+			std::cout << "option name SaveHash type button\n";
+			std::cout << "option name LoadHash type button\n";
+			std::cout << "option name Threads type spin default 1 min 1 max 256\n";
+			std::cout << "option name MultiPV type spin default 1 min 1 max 256\n";
+			std::cout << "option name Ponder type check default false\n";
+			std::cout << "option name NullMovePruning type check default true\n";
+			std::cout << "option name LateMoveReductions type check default true\n";
+			std::cout << "option name ReverseFutilityPruning type check default true\n";
+			std::cout << "option name FutilityPruning type check default true\n";
+			std::cout << "option name LateMovePruning type check default true\n";
+			std::cout << "option name PseudoLegalMoves type check default false\n";
+			std::cout << "option name IncrementalAttacks type check default false\n";
+			std::cout << "option name BookFile type string default <empty>\n";
+			std::cout << "option name BookSelection type combo default best var best var weighted\n";
+			std::cout << "option name TablebasePath type string default <empty>\n";
+			std::cout << "uciok" << std::endl;
+		} else if(command == "isready") {
+			std::cout << "readyok" << std::endl;
+		} else if(command == "ucinewgame") {
+			stop_search();
+			// A persistent table is kept across games, that is what it is for
+			if(!tt.file_backed) {
+				tt.clear();
+			}
+			search->clear();
+		} else if(command == "position") {
+			stop_search();
+			parse_position(board, stream);
+		} else if(command == "go") {
+			stop_search();
+			reset_statistics();
+			std::string token;
+			if(stream >> token && token == "perft") {
+				int depth = 1;
+				stream >> depth;
+				perft_split(board, depth);
+				continue;
+			}
+			std::istringstream limits_stream(line.substr(2));
+			parse_go(search->limits, limits_stream);
+
+			// Answer straight from the opening book when it has the position
+			Move book_move = search->limits.infinite || search->limits.ponder ? Move() : book.probe(board);
+			if(book_move != Move()) {
+				std::cout << "info string book move\n";
+				std::cout << "bestmove " << board.move_to_uci(book_move) << std::endl;
+				continue;
+			}
+
+			search->board = board;
+			search->stop = false;
+			search->pondering = search->limits.ponder;
+			search->reset_tree_statistics();
+			search_thread = std::thread([&search]() {
+				Move best_move = search->start();
+				search->print_tree_statistics("info string ");
+				std::cout << "bestmove " << search->board.move_to_uci(best_move);
+				if(search->ponder_move != PackedMove()) {
+					std::cout << " ponder " << search->board.move_to_uci(search->ponder_move);
+				}
+				std::cout << std::endl;
+			});
+		} else if(command == "ponderhit") {
+			// The expected reply was played: the running search goes on, now on our clock
+			search->pondering = false;
+		} else if(command == "stop") {
+			stop_search();
+		} else if(command == "setoption") {
+			stop_search();
+			parse_setoption(board, *search, tt, book, tablebases, stream);
+		} else if(command == "d") {
+			char fen [max_fen_length];
+			board.to_fen(fen);
+			board.print();
+			std::cout << "Fen: " << fen << "\n";
+		} else if(command == "stats") {
+			// Counters since the last go, "stats json" for a machine readable line
+			std::string format;
+			stream >> format;
+			print_statistics(format == "json");
+		} else if(command == "quit") {
+			break;
+		}
+	}
+	stop_search();
+}
@@ -0,0 +1,15 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include <string>
+#include "board.h"
+
+const std::string start_position = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Find the legal move written in long algebraic notation, or an empty move if there is none
+Move parse_move(Board &board, std::string text);
+
+// Read and answer UCI commands from standard input until quit
+void uci_loop(Board &board);
+
+#endif